@@ -7,8 +7,15 @@
 #include <string.h>
 #include "chry_blockpool.h"
 
+#ifdef CHRY_BLOCKPOOL_WAIT
+#include "chry_blockpool_wait.h"
+#endif
+
 static int util_fls(uint32_t word)
 {
+#if defined(__GNUC__) || defined(__clang__)
+    return word ? (32 - __builtin_clz(word)) : 0;
+#else
     int bit = 32;
 
     if (!word) {
@@ -26,16 +33,680 @@ static int util_fls(uint32_t word)
         word <<= 4;
         bit -= 4;
     }
-    if (!(word & 0xc0000000)) {
-        word <<= 2;
-        bit -= 2;
+    if (!(word & 0xc0000000)) {
+        word <<= 2;
+        bit -= 2;
+    }
+    if (!(word & 0x80000000)) {
+        word <<= 1;
+        bit -= 1;
+    }
+
+    return bit;
+#endif
+}
+
+static uint32_t util_entry_size(uint32_t flags, uint32_t block_cnt)
+{
+    if (flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        return 0;
+    } else if (flags & CHRY_BLOCKPOOL_FLAG_INDEX) {
+        return (block_cnt > 0x10000) ? sizeof(uint32_t) : sizeof(uint16_t);
+    }
+
+    return sizeof(void *);
+}
+
+static uint32_t util_inverse(uint32_t odd)
+{
+    /*!< newton iteration, 3 correct bit double each step */
+    uint32_t inv = odd;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        inv *= 2 - odd * inv;
+    }
+
+    return inv;
+}
+
+static uint32_t util_index(chry_blockpool_t *bp, void *addr)
+{
+    /*!< block size = odd << shift, offset is exact multiple, no divide */
+    return ((uint32_t)((uintptr_t)addr - (uintptr_t)(bp->pool)) >> bp->block_shift) * bp->block_inv;
+}
+
+static void *util_load(chry_blockpool_t *bp, uint32_t offset)
+{
+    void *entry = (uint8_t *)(bp->rb_pool) + offset;
+
+    /*!< entry aligned to its size, one load */
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_INDEX)) {
+        return *(void **)entry;
+    } else if (sizeof(uint16_t) == bp->entry_size) {
+        return (void *)((uintptr_t)(bp->pool) + *(uint16_t *)entry * bp->block_size);
+    } else {
+        return (void *)((uintptr_t)(bp->pool) + *(uint32_t *)entry * bp->block_size);
+    }
+}
+
+static void util_store(chry_blockpool_t *bp, uint32_t offset, void *addr)
+{
+    void *entry = (uint8_t *)(bp->rb_pool) + offset;
+
+    /*!< entry aligned to its size, one store */
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_INDEX)) {
+        *(void **)entry = addr;
+    } else if (sizeof(uint16_t) == bp->entry_size) {
+        *(uint16_t *)entry = (uint16_t)util_index(bp, addr);
+    } else {
+        *(uint32_t *)entry = util_index(bp, addr);
+    }
+}
+
+static uint32_t util_reserve(chry_blockpool_t *bp, uint32_t n, bool all, uint32_t *in)
+{
+    uint32_t head = atomic_load_explicit(&(bp->head), memory_order_relaxed);
+    uint32_t cnt;
+    uint32_t space;
+
+    do {
+        /*!< read pointer acquire, alloc thread done with entry before reuse */
+        space = (bp->rb_mask + 1 - (head - atomic_load_explicit(&(bp->out), memory_order_acquire))) / bp->entry_size;
+        cnt = n > space ? space : n;
+
+        if ((0 == cnt) || (all && (cnt < n))) {
+            return 0;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&(bp->head), &head, head + cnt * bp->entry_size, memory_order_relaxed, memory_order_relaxed));
+
+    *in = head;
+
+    return cnt;
+}
+
+static void util_commit(chry_blockpool_t *bp, uint32_t in, uint32_t n)
+{
+    /*!< publish in reserve order, acquire earlier free thread entry so our release carry it */
+    while (atomic_load_explicit(&(bp->in), memory_order_acquire) != in) {
+    }
+
+    atomic_store_explicit(&(bp->in), in + n * bp->entry_size, memory_order_release);
+}
+
+static int util_push(chry_blockpool_t *bp, void *addr)
+{
+    uint32_t in;
+
+    /*!< lifo mode link block through its first word */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        memcpy(addr, &(bp->free_list), sizeof(void *));
+        bp->free_list = addr;
+        bp->free_cnt++;
+        return 0;
+    }
+
+    /*!< mpsc mode reserve one entry, publish after earlier free thread */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC) {
+        if (0 == util_reserve(bp, 1, true, &in)) {
+            return -1;
+        }
+
+        util_store(bp, in & bp->rb_mask, addr);
+        util_commit(bp, in, 1);
+        return 0;
+    }
+
+    /*!< only free side write it, relaxed */
+    in = atomic_load_explicit(&(bp->in), memory_order_relaxed);
+
+    /*!< ringbuffer size is multiple of entry size, reload read pointer only when look full */
+    if ((in - bp->out_cache) > (bp->rb_mask + 1 - bp->entry_size)) {
+        bp->out_cache = atomic_load_explicit(&(bp->out), memory_order_acquire);
+
+        if ((in - bp->out_cache) > (bp->rb_mask + 1 - bp->entry_size)) {
+            return -1;
+        }
+    }
+
+    util_store(bp, in & bp->rb_mask, addr);
+    atomic_store_explicit(&(bp->in), in + bp->entry_size, memory_order_release);
+
+    return 0;
+}
+
+static int util_pop(chry_blockpool_t *bp, void **addr)
+{
+    uint32_t out = atomic_load_explicit(&(bp->out), memory_order_relaxed);
+
+    /*!< lifo mode hand out the most recently freed block */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        if (NULL == bp->free_list) {
+            return -1;
+        }
+
+        *addr = bp->free_list;
+        memcpy(&(bp->free_list), *addr, sizeof(void *));
+        bp->free_cnt--;
+        return 0;
+    }
+
+    /*!< reload write pointer only when look empty, bulk pop may pass the copy, acquire entry written before published */
+    if ((int32_t)(bp->in_cache - out) <= 0) {
+        bp->in_cache = atomic_load_explicit(&(bp->in), memory_order_acquire);
+
+        if (bp->in_cache == out) {
+            return -1;
+        }
+    }
+
+    *addr = util_load(bp, out & bp->rb_mask);
+    atomic_store_explicit(&(bp->out), out + bp->entry_size, memory_order_release);
+
+    return 0;
+}
+
+static uint32_t util_free_cnt(chry_blockpool_t *bp)
+{
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        return bp->free_cnt;
+    }
+
+    return (atomic_load_explicit(&(bp->in), memory_order_acquire) - atomic_load_explicit(&(bp->out), memory_order_relaxed)) / bp->entry_size;
+}
+
+static uint32_t util_free_space(chry_blockpool_t *bp)
+{
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        return UINT32_MAX;
+    }
+
+    /*!< free side only, read pointer copy refreshed */
+    bp->out_cache = atomic_load_explicit(&(bp->out), memory_order_acquire);
+
+    return (bp->rb_mask + 1 - (atomic_load_explicit(&(bp->in), memory_order_relaxed) - bp->out_cache)) / bp->entry_size;
+}
+
+static void util_pop_bulk(chry_blockpool_t *bp, void **addrs, uint32_t n)
+{
+    uint32_t offset;
+    uint32_t remain;
+
+    /*!< lifo mode unlink n blocks, one head update */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        void *block = bp->free_list;
+
+        for (uint32_t i = 0; i < n; i++) {
+            addrs[i] = block;
+            memcpy(&block, block, sizeof(void *));
+        }
+
+        bp->free_list = block;
+        bp->free_cnt -= n;
+        return;
+    }
+
+    offset = atomic_load_explicit(&(bp->out), memory_order_relaxed) & bp->rb_mask;
+
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_INDEX)) {
+        /*!< pointer entry, copy at most two contiguous segment */
+        remain = bp->rb_mask + 1 - offset;
+        remain = remain > n * sizeof(void *) ? n * sizeof(void *) : remain;
+
+        memcpy(addrs, ((uint8_t *)(bp->rb_pool)) + offset, remain);
+        memcpy((uint8_t *)addrs + remain, bp->rb_pool, n * sizeof(void *) - remain);
+    } else {
+        /*!< index entry never cross ringbuffer end, size is power of 2 */
+        for (uint32_t i = 0; i < n; i++) {
+            addrs[i] = util_load(bp, offset);
+            offset = (offset + bp->entry_size) & bp->rb_mask;
+        }
+    }
+
+    /*!< publish read pointer once */
+    atomic_store_explicit(&(bp->out), atomic_load_explicit(&(bp->out), memory_order_relaxed) + n * bp->entry_size, memory_order_release);
+}
+
+static uint32_t util_push_bulk(chry_blockpool_t *bp, void *const *addrs, uint32_t n, bool all)
+{
+    uint32_t in = 0;
+    uint32_t offset;
+    uint32_t remain;
+
+    if (0 == n) {
+        return 0;
+    }
+
+    /*!< lifo mode chain n blocks, one head update */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        for (uint32_t i = 0; i < n - 1; i++) {
+            memcpy(addrs[i], &addrs[i + 1], sizeof(void *));
+        }
+
+        memcpy(addrs[n - 1], &(bp->free_list), sizeof(void *));
+        bp->free_list = addrs[0];
+        bp->free_cnt += n;
+        return n;
+    }
+
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC) {
+        n = util_reserve(bp, n, all, &in);
+    } else {
+        in = atomic_load_explicit(&(bp->in), memory_order_relaxed);
+        remain = util_free_space(bp);
+        n = (all && (remain < n)) ? 0 : (n > remain ? remain : n);
+    }
+
+    if (0 == n) {
+        return 0;
+    }
+
+    offset = in & bp->rb_mask;
+
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_INDEX)) {
+        /*!< pointer entry, copy at most two contiguous segment */
+        remain = bp->rb_mask + 1 - offset;
+        remain = remain > n * sizeof(void *) ? n * sizeof(void *) : remain;
+
+        memcpy(((uint8_t *)(bp->rb_pool)) + offset, addrs, remain);
+        memcpy(bp->rb_pool, (const uint8_t *)addrs + remain, n * sizeof(void *) - remain);
+    } else {
+        /*!< index entry never cross ringbuffer end, size is power of 2 */
+        for (uint32_t i = 0; i < n; i++) {
+            util_store(bp, offset, addrs[i]);
+            offset = (offset + bp->entry_size) & bp->rb_mask;
+        }
+    }
+
+    /*!< publish write pointer once */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC) {
+        util_commit(bp, in, n);
+    } else {
+        atomic_store_explicit(&(bp->in), in + n * bp->entry_size, memory_order_release);
+    }
+
+    return n;
+}
+
+static uint32_t util_map_size(uint32_t block_cnt)
+{
+    /*!< alloc side and free side bitmap, one bit per block each */
+    return ((block_cnt + 31) / 32) * sizeof(uint32_t) * 2;
+}
+
+static uint64_t util_layout_size(uint32_t block_cnt, uint32_t block_size, uint32_t entry_size, uint32_t flags, uint32_t *rb_offset)
+{
+    /*!< 64 bit, a layout past 4 GiB must compare larger than size, not wrap */
+    uint64_t offset = (uint64_t)block_cnt * block_size;
+    uint64_t ring = (uint64_t)block_cnt * entry_size;
+
+    if (flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        offset += util_map_size(block_cnt);
+    }
+
+    /*!< lifo mode has no ringbuffer */
+    if (0 == entry_size) {
+        *rb_offset = (uint32_t)offset;
+        return offset;
+    }
+
+    /*!< ringbuffer aligned to entry size, entry size is power of 2 */
+    offset = (offset + entry_size - 1) & ~(uint64_t)(entry_size - 1);
+    *rb_offset = (uint32_t)offset;
+
+    /*!< ringbuffer size align up to power of 2, above 2 GiB it never fit */
+    if (ring > 0x80000000ULL) {
+        return UINT64_MAX;
+    }
+
+    return offset + ((uint64_t)0x1 << util_fls((uint32_t)ring - 1));
+}
+
+static uint32_t util_layout_cnt(uint32_t block_size, uint32_t flags, uint32_t size)
+{
+    /*!< closed form upper bound, two bitmap cost 2 bit, 1/4 byte per block */
+    if (flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        return (uint32_t)(((uint64_t)size * 4) / ((uint64_t)block_size * 4 + 1));
+    }
+
+    return size / block_size;
+}
+
+static uint32_t util_layout_settle(uint32_t block_cnt, uint32_t block_size, uint32_t entry_size, uint32_t flags, uint32_t size)
+{
+    uint32_t rb_offset;
+
+    /*!< only bitmap word and ringbuffer align round up past the bound, settle in few step */
+    while (block_cnt && (util_layout_size(block_cnt, block_size, entry_size, flags, &rb_offset) > size)) {
+        block_cnt--;
+    }
+
+    return block_cnt;
+}
+
+static void util_map_toggle(_Atomic uint32_t *map, uint32_t idx)
+{
+    /*!< single writer per map, plain read modify write, relaxed for reader on other side */
+    uint32_t word = atomic_load_explicit(&(map[idx / 32]), memory_order_relaxed);
+
+    atomic_store_explicit(&(map[idx / 32]), word ^ (0x1UL << (idx % 32)), memory_order_relaxed);
+}
+
+static uint32_t util_map_test(_Atomic uint32_t *map, uint32_t idx)
+{
+    return (atomic_load_explicit(&(map[idx / 32]), memory_order_relaxed) >> (idx % 32)) & 0x1;
+}
+
+static void util_map_set(_Atomic uint32_t *map, uint32_t idx, uint32_t val)
+{
+    uint32_t word = atomic_load_explicit(&(map[idx / 32]), memory_order_relaxed);
+
+    atomic_store_explicit(&(map[idx / 32]), (word & ~(0x1UL << (idx % 32))) | (val << (idx % 32)), memory_order_relaxed);
+}
+
+static void util_map_release(chry_blockpool_t *bp, uint32_t idx)
+{
+    /*!< mpsc free threads share free side bitmap word */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC) {
+        atomic_fetch_xor_explicit(&(bp->free_map[idx / 32]), 0x1UL << (idx % 32), memory_order_relaxed);
+    } else {
+        util_map_toggle(bp->free_map, idx);
+    }
+}
+
+static int util_map_claim(chry_blockpool_t *bp, uint32_t idx)
+{
+    uint32_t bit = 0x1UL << (idx % 32);
+    uint32_t old;
+
+    /*!< flip free side first, racing double free see it already flipped */
+    old = atomic_fetch_xor_explicit(&(bp->free_map[idx / 32]), bit, memory_order_relaxed);
+
+    if (!!(old & bit) == util_map_test(bp->alloc_map, idx)) {
+        atomic_fetch_xor_explicit(&(bp->free_map[idx / 32]), bit, memory_order_relaxed);
+        return -1;
+    }
+
+    return 0;
+}
+
+static uint32_t util_reclaim(chry_blockpool_t *bp)
+{
+    void *block;
+    void *next;
+    uint32_t cnt = 0;
+
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_REMOTE) || (NULL == atomic_load_explicit(&(bp->remote_list), memory_order_relaxed))) {
+        return 0;
+    }
+
+    /*!< take whole remote list at once, remote free threads keep pushing to new list */
+    for (block = atomic_exchange_explicit(&(bp->remote_list), NULL, memory_order_acquire); NULL != block; block = next, cnt++) {
+        memcpy(&next, block, sizeof(void *));
+
+        /*!< alloc thread push, one producer only when owner do local free too, else mpsc reserve */
+        util_push(bp, block);
+
+        if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+            util_map_release(bp, util_index(bp, block));
+        }
+    }
+
+#ifdef CHRY_BLOCKPOOL_WAIT
+    atomic_fetch_sub_explicit(&(bp->remote_cnt), cnt, memory_order_relaxed);
+#endif
+
+    return cnt;
+}
+
+static uint32_t util_bump_cnt(chry_blockpool_t *bp)
+{
+    return bp->bump_limit - atomic_load_explicit(&(bp->bump), memory_order_relaxed);
+}
+
+static void util_bump(chry_blockpool_t *bp, void **addrs, uint32_t n)
+{
+    /*!< only alloc side write it, free side read it to reject never used block */
+    uint32_t bump = atomic_load_explicit(&(bp->bump), memory_order_relaxed);
+
+    for (uint32_t i = 0; i < n; i++, bump++) {
+        addrs[i] = (void *)((uintptr_t)(bp->pool) + bump * bp->block_size);
+
+        /*!< bitmap never cleared in lazy mode, set alloc side differ from free side */
+        if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+            util_map_set(bp->alloc_map, bump, !util_map_test(bp->free_map, bump));
+        }
+    }
+
+    atomic_store_explicit(&(bp->bump), bump, memory_order_relaxed);
+}
+
+static void util_fill(chry_blockpool_t *bp)
+{
+    void *pool = bp->pool;
+
+    atomic_init(&(bp->head), atomic_load_explicit(&(bp->in), memory_order_relaxed));
+    atomic_init(&(bp->remote_list), NULL);
+
+    /*!< lazy mode every block is never used, nothing to touch */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LAZY) {
+        bp->free_list = NULL;
+        bp->free_cnt = 0;
+        atomic_init(&(bp->bump), 0);
+        return;
+    }
+
+    atomic_init(&(bp->bump), bp->block_cnt);
+
+    /*!< all blocks free, both side bitmap equal */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        memset((void *)(bp->alloc_map), 0, util_map_size(bp->block_cnt));
+    }
+
+    /*!< fill lifo list from tail, first block on top */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        bp->free_list = NULL;
+        bp->free_cnt = 0;
+
+        for (uint32_t i = bp->block_cnt; i > 0; i--) {
+            util_push(bp, (void *)((uintptr_t)pool + (i - 1) * bp->block_size));
+        }
+        return;
+    }
+
+    /*!< fill all free blocks to ringbuffer */
+    for (uint32_t i = 0; i < bp->block_cnt; i++) {
+        util_push(bp, pool);
+        pool = (void *)((uintptr_t)pool + bp->block_size);
+    }
+}
+
+static void util_notify(chry_blockpool_t *bp)
+{
+#ifdef CHRY_BLOCKPOOL_WAIT
+    /*!< waiter side issue membarrier, compiler barrier enough here */
+    atomic_signal_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&(bp->waiters), memory_order_relaxed)) {
+        chry_blockpool_wake(bp);
+    }
+#else
+    (void)bp;
+#endif
+}
+
+static uint32_t util_region_blocks(chry_blockpool_t *bp)
+{
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    return bp->region_blocks;
+#else
+    (void)bp;
+    return 0;
+#endif
+}
+
+static int util_region_check(chry_blockpool_t *bp, void *addr)
+{
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    uint32_t lo = 0;
+    uint32_t hi = bp->region_cnt;
+    uint32_t mid;
+    uintptr_t address;
+
+    /*!< last region start at or below addr */
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+
+        if ((uintptr_t)addr < (uintptr_t)(bp->regions[mid].pool)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    if (0 == lo) {
+        return -1;
+    }
+
+    /*!< same range and align check as first region */
+    address = (uintptr_t)addr - (uintptr_t)(bp->regions[lo - 1].pool);
+
+    return (chry_blockpool_calc_index(address, bp->block_size, bp->block_shift, bp->block_inv, bp->regions[lo - 1].block_cnt) >= bp->regions[lo - 1].block_cnt) ? -1 : 0;
+#else
+    (void)bp;
+    (void)addr;
+    return -1;
+#endif
+}
+
+static void util_fill_region(chry_blockpool_t *bp)
+{
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    for (uint32_t r = 0; r < bp->region_cnt; r++) {
+        for (uint32_t i = 0; i < bp->regions[r].block_cnt; i++) {
+            util_push(bp, (void *)((uintptr_t)(bp->regions[r].pool) + i * bp->block_size));
+        }
+    }
+#else
+    (void)bp;
+#endif
+}
+
+/*****************************************************************************
+* @brief        calculate division free block index constant,
+*               index is (offset >> shift) * inv for exact multiple,
+*               non multiple with low bits clear land out of range
+* 
+* @param[in]    block_size  block size in byte, not zero
+* @param[out]   shift       block size power of 2
+* @param[out]   inv         block size odd part inverse mod 2^32
+* 
+*****************************************************************************/
+void chry_blockpool_calc_inverse(uint32_t block_size, uint32_t *shift, uint32_t *inv)
+{
+    *shift = util_fls(block_size & (~block_size + 1)) - 1;
+    *inv = util_inverse(block_size >> *shift);
+}
+
+/*****************************************************************************
+* @brief        calculate division free quotient constant,
+*               exact floor for every 32 bit dividend, not only multiple
+* 
+* @param[in]    divisor     divisor, not zero
+* @param[out]   mul         reciprocal low 32 bit, 33rd bit implied
+* @param[out]   shift       divisor round up power of 2
+* 
+*****************************************************************************/
+void chry_blockpool_calc_reciprocal(uint32_t divisor, uint32_t *mul, uint32_t *shift)
+{
+    /*!< mul = 2^32 * (2^shift - divisor) / divisor + 1 */
+    *shift = (uint32_t)util_fls(divisor - 1);
+    *mul = (uint32_t)(((((uint64_t)0x1 << *shift) - divisor) << 32) / divisor + 1);
+}
+
+/*****************************************************************************
+* @brief        calculate blockpool layout without init,
+*               block area, bitmap, then free ringbuffer
+* 
+* @param[out]   layout      layout result
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    size        memory size in byte
+* @param[in]    flags       CHRY_BLOCKPOOL_FLAG_xxx
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_calc_layout(chry_blockpool_layout_t *layout, uint32_t align, uint32_t block_size, uint32_t size, uint32_t flags)
+{
+    uint32_t block_cnt = 0;
+    uint32_t entry_size = 0;
+    uint64_t used;
+
+    /*!< check param */
+    if ((0 == block_size) || (0 == size) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096)) {
+        return -1;
+    }
+
+    /*!< lifo and remote mode keep link pointer in block */
+    if ((flags & (CHRY_BLOCKPOOL_FLAG_LIFO | CHRY_BLOCKPOOL_FLAG_REMOTE)) && (block_size < sizeof(void *))) {
+        block_size = sizeof(void *);
+    }
+
+    /*!< block size align up */
+    if (block_size & ((0x1 << align) - 1)) {
+        block_size = (block_size & (~((0x1 << align) - 1))) + (0x1 << align);
+    }
+
+    if (flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        block_cnt = util_layout_settle(util_layout_cnt(block_size, flags, size), block_size, 0, flags, size);
+    } else {
+        /*!< try each power of 2 ringbuffer size, keep the one fit most blocks */
+        for (uint32_t bit = 1; bit < 32; bit++) {
+            uint32_t rb_size = 0x1UL << bit;
+
+            if (rb_size >= size) {
+                break;
+            }
+
+            /*!< index mode try 16 bit then 32 bit entry, else pointer entry */
+            for (uint32_t es = util_entry_size(flags, 1); es <= util_entry_size(flags, 0x10001); es <<= 1) {
+                uint32_t cnt = util_layout_cnt(block_size, flags, size - rb_size);
+                uint32_t max_cnt = rb_size / es;
+
+                /*!< 16 bit index entry hold at most 65536 blocks */
+                if ((flags & CHRY_BLOCKPOOL_FLAG_INDEX) && (sizeof(uint16_t) == es) && (max_cnt > 0x10000)) {
+                    max_cnt = 0x10000;
+                }
+
+                cnt = cnt > max_cnt ? max_cnt : cnt;
+                cnt = util_layout_settle(cnt, block_size, es, flags, size);
+
+                if (cnt > block_cnt) {
+                    block_cnt = cnt;
+                    entry_size = es;
+                }
+            }
+        }
+    }
+
+    if (0 == block_cnt) {
+        return -1;
     }
-    if (!(word & 0x80000000)) {
-        word <<= 1;
-        bit -= 1;
+
+    layout->block_cnt = block_cnt;
+    layout->block_size = block_size;
+    layout->entry_size = entry_size;
+    layout->map_size = (flags & CHRY_BLOCKPOOL_FLAG_BITMAP) ? util_map_size(block_cnt) : 0;
+    used = util_layout_size(block_cnt, block_size, entry_size, flags, &(layout->rb_offset));
+
+    /*!< settle keep the layout inside size, never trust a larger one */
+    if (used > size) {
+        return -1;
     }
 
-    return bit;
+    layout->rb_size = (uint32_t)used - layout->rb_offset;
+    layout->waste_size = size - (uint32_t)used;
+
+    return 0;
 }
 
 /*****************************************************************************
@@ -44,71 +715,197 @@ static int util_fls(uint32_t word)
 * @param[in]    bp          blockpool instance
 * @param[in]    align       block align
 * @param[in]    block_size  block size in byte
-* @param[in]    pool        memory pool address
+* @param[in]    pool        memory pool address, align to pointer size
 * @param[in]    size        memory size in byte
 * 
 * @retval int               0:Success -1:Error
 *****************************************************************************/
 int chry_blockpool_init(chry_blockpool_t *bp, uint32_t align, uint32_t block_size, void *pool, uint32_t size)
 {
-    uint32_t block_cnt;
-    uint32_t align_rb_size;
+    return chry_blockpool_init_ex(bp, align, block_size, pool, size, 0);
+}
 
-    /*!< check param */
-    if ((0 == block_size) || (0 == size) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096)) {
+/*****************************************************************************
+* @brief        init blockpool with flags
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    pool        memory pool address, align to ringbuffer entry size
+*                           (pointer, or index width), and to 4 with bitmap
+* @param[in]    size        memory size in byte
+* @param[in]    flags       CHRY_BLOCKPOOL_FLAG_xxx
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_init_ex(chry_blockpool_t *bp, uint32_t align, uint32_t block_size, void *pool, uint32_t size, uint32_t flags)
+{
+    chry_blockpool_layout_t layout;
+
+    /*!< mpsc mode reserve on ringbuffer by CAS, lifo has none, reject before bp is touched */
+    if ((flags & CHRY_BLOCKPOOL_FLAG_MPSC) && (flags & CHRY_BLOCKPOOL_FLAG_LIFO)) {
         return -1;
     }
 
-    /*!< block size align up */
-    if (block_size & ((0x1 << align) - 1)) {
-        block_size = (block_size & (~((0x1 << align) - 1))) + (0x1 << align);
+    if (chry_blockpool_calc_layout(&layout, align, block_size, size, flags)) {
+        return -1;
+    }
+
+    /*!< layout offset relative to pool, bitmap word and ringbuffer entry need absolute align */
+    if ((flags & CHRY_BLOCKPOOL_FLAG_BITMAP) && (((uintptr_t)pool + layout.block_size * layout.block_cnt) & (sizeof(uint32_t) - 1))) {
+        return -1;
     }
 
-    /*!< calculate max block cnt */
-    block_cnt = size / block_size;
+    if (layout.rb_size && (((uintptr_t)pool + layout.rb_offset) & (layout.entry_size - 1))) {
+        return -1;
+    }
 
-    while (1) {
-        if (0 == block_cnt) {
-            return -1;
-        }
+    bp->block_size = layout.block_size;
+    chry_blockpool_calc_inverse(layout.block_size, &(bp->block_shift), &(bp->block_inv));
+    bp->block_cnt = layout.block_cnt;
+    bp->flags = flags;
+    bp->entry_size = layout.entry_size;
+    bp->pool = pool;
+    bp->bump_limit = layout.block_cnt;
 
-        /*!< free ringbuffer size in byte */
-        uint32_t rb_size = block_cnt * sizeof(void *);
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    bp->region_cnt = 0;
+    bp->region_blocks = 0;
+#endif
 
-        /*!< align rb_size to power of 2 */
-        align_rb_size = util_fls(rb_size);
-        if (rb_size & ((1 << (align_rb_size - 1)) - 1)) {
-            align_rb_size = 1 << align_rb_size;
-        } else {
-            align_rb_size = 1 << (align_rb_size - 1);
+#ifdef CHRY_BLOCKPOOL_WAIT
+    atomic_init(&(bp->waiters), 0);
+    atomic_init(&(bp->sleepers), 0);
+    atomic_init(&(bp->wake_seq), 0);
+    atomic_init(&(bp->armed), 0);
+    atomic_init(&(bp->remote_cnt), 0);
+    bp->low_water = 1;
+    bp->event_fd = -1;
+#endif
+
+    /*!< bitmap placed after block area, keep ringbuffer word aligned */
+    if (flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        bp->alloc_map = (_Atomic uint32_t *)((uintptr_t)pool + layout.block_size * layout.block_cnt);
+        bp->free_map = bp->alloc_map + (layout.block_cnt + 31) / 32;
+    } else {
+        bp->alloc_map = NULL;
+        bp->free_map = NULL;
+    }
+
+    /*!< free block ringbuffer placed last, size is power of 2, lifo has none */
+    bp->rb_pool = layout.rb_size ? (void *)((uintptr_t)pool + layout.rb_offset) : NULL;
+    bp->rb_mask = layout.rb_size ? layout.rb_size - 1 : 0;
+
+    chry_blockpool_reset(bp);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        add one more memory region to blockpool, blocks of region join
+*               the same free ringbuffer (or list), when ringbuffer too small a
+*               larger one is carved after region blocks, old one left unused,
+*               not valid with bitmap or index flag, lazy bump stay in first region,
+*               should be add lock in mutithread, no alloc nor free may run
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    pool        region memory address, align to block align,
+*                           ringbuffer carved after it is pointer aligned
+* @param[in]    size        region memory size in byte
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_add_region(chry_blockpool_t *bp, void *pool, uint32_t size)
+{
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    uint32_t total = bp->block_cnt + bp->region_blocks;
+    uint32_t rb_offset = 0;
+    uint32_t rb_size = 0;
+    uint32_t cnt;
+    uint32_t pos;
+    uint32_t out;
+    uintptr_t start = (uintptr_t)pool;
+    uintptr_t end;
+
+    /*!< region block has no index, alloc path stay single region */
+    if ((bp->flags & (CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_INDEX)) || (bp->region_cnt == CHRY_BLOCKPOOL_REGION_MAX)) {
+        return -1;
+    }
+
+    /*!< region block first, then ringbuffer for all block when current one too small */
+    for (cnt = size / bp->block_size; cnt > 0; cnt--) {
+        if ((bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) || ((total + cnt) * sizeof(void *) <= bp->rb_mask + 1)) {
+            rb_size = 0;
+            break;
         }
 
-        /*!< free space after block area */
-        uint32_t free_size = size - (block_cnt * block_size);
+        /*!< entry align by address, region itself may be unaligned */
+        rb_offset = (uint32_t)(((start + cnt * bp->block_size + sizeof(void *) - 1) & ~(uintptr_t)(sizeof(void *) - 1)) - start);
+        rb_size = 0x1UL << util_fls((total + cnt) * sizeof(void *) - 1);
 
-        if (free_size >= align_rb_size) {
+        if (rb_offset + rb_size <= size) {
             break;
-        } else {
-            block_cnt -= 1;
         }
     }
 
-    bp->block_size = block_size;
-    bp->block_cnt = block_cnt;
-    bp->pool = pool;
+    if (0 == cnt) {
+        return -1;
+    }
 
-    /*!< init free block ringbuffer */
-    if (chry_ringbuffer_init(&(bp->rb_free), (void *)((uintptr_t)pool + block_size * block_cnt), align_rb_size)) {
+    end = start + (uintptr_t)cnt * bp->block_size;
+
+    /*!< no overlap with first region nor other region */
+    if ((start < (uintptr_t)(bp->pool) + (uintptr_t)bp->block_cnt * bp->block_size) && (end > (uintptr_t)(bp->pool))) {
         return -1;
     }
 
-    /*!< fill all free blocks to ringbuffer */
-    for (uint32_t i = 0; i < block_cnt; i++) {
-        chry_ringbuffer_write(&(bp->rb_free), (void *)&pool, sizeof(void *));
-        pool = (void *)((uintptr_t)pool + block_size);
+    for (pos = 0; (pos < bp->region_cnt) && ((uintptr_t)(bp->regions[pos].pool) < start); pos++) {
+    }
+
+    if ((pos > 0) && (start < (uintptr_t)(bp->regions[pos - 1].pool) + (uintptr_t)bp->regions[pos - 1].block_cnt * bp->block_size)) {
+        return -1;
+    }
+
+    if ((pos < bp->region_cnt) && (end > (uintptr_t)(bp->regions[pos].pool))) {
+        return -1;
+    }
+
+    /*!< move free entry to new ringbuffer, read pointer restart from 0 */
+    if (rb_size) {
+        out = atomic_load_explicit(&(bp->out), memory_order_relaxed);
+        total = util_free_cnt(bp);
+
+        for (uint32_t i = 0; i < total; i++, out += sizeof(void *)) {
+            memcpy((uint8_t *)pool + rb_offset + i * sizeof(void *), (uint8_t *)(bp->rb_pool) + (out & bp->rb_mask), sizeof(void *));
+        }
+
+        bp->rb_pool = (uint8_t *)pool + rb_offset;
+        bp->rb_mask = rb_size - 1;
+
+        atomic_store_explicit(&(bp->out), 0, memory_order_relaxed);
+        atomic_store_explicit(&(bp->in), total * sizeof(void *), memory_order_relaxed);
+        atomic_store_explicit(&(bp->head), total * sizeof(void *), memory_order_relaxed);
+        bp->in_cache = total * sizeof(void *);
+        bp->out_cache = 0;
+    }
+
+    memmove(&(bp->regions[pos + 1]), &(bp->regions[pos]), (bp->region_cnt - pos) * sizeof(chry_blockpool_region_t));
+    bp->regions[pos].pool = pool;
+    bp->regions[pos].block_cnt = cnt;
+    bp->region_cnt++;
+    bp->region_blocks += cnt;
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        util_push(bp, (void *)(start + i * bp->block_size));
     }
 
     return 0;
+#else
+    (void)bp;
+    (void)pool;
+    (void)size;
+    return -1;
+#endif
 }
 
 /*****************************************************************************
@@ -120,15 +917,98 @@ int chry_blockpool_init(chry_blockpool_t *bp, uint32_t align, uint32_t block_siz
 *****************************************************************************/
 void chry_blockpool_reset(chry_blockpool_t *bp)
 {
-    void *pool = bp->pool;
+    atomic_init(&(bp->in), 0);
+    atomic_init(&(bp->out), 0);
+    bp->in_cache = 0;
+    bp->out_cache = 0;
 
-    chry_ringbuffer_reset(&(bp->rb_free));
+    util_fill(bp);
+    util_fill_region(bp);
+}
 
-    /*!< fill all free blocks to ringbuffer */
-    for (uint32_t i = 0; i < bp->block_cnt; i++) {
-        chry_ringbuffer_write(&(bp->rb_free), (void *)&pool, sizeof(void *));
-        pool = (void *)((uintptr_t)pool + bp->block_size);
+/*****************************************************************************
+* @brief        set usable block limit in lazy mode, block at or above limit
+*               never handed out, memory behind them may be decommitted,
+*               should be called by alloc thread
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    limit       usable block count, not below bump index
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_set_limit(chry_blockpool_t *bp, uint32_t limit)
+{
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_LAZY) || (limit > bp->block_cnt) || (limit < atomic_load_explicit(&(bp->bump), memory_order_relaxed))) {
+        return -1;
+    }
+
+    bp->bump_limit = limit;
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        trim free tail in lazy mode with bitmap, free blocks above the
+*               last used block leave free list and return to never used,
+*               should be add lock in mutithread, no alloc nor free may run
+* 
+* @param[in]    bp          blockpool instance
+* 
+* @retval uint32_t          new bump index, blocks from it are never used
+*****************************************************************************/
+uint32_t chry_blockpool_trim(chry_blockpool_t *bp)
+{
+    uint32_t top = atomic_load_explicit(&(bp->bump), memory_order_relaxed);
+    uint32_t cnt;
+    void *addr;
+    void *next;
+    void *prev = NULL;
+
+    if ((bp->flags & (CHRY_BLOCKPOOL_FLAG_LAZY | CHRY_BLOCKPOOL_FLAG_BITMAP)) != (CHRY_BLOCKPOOL_FLAG_LAZY | CHRY_BLOCKPOOL_FLAG_BITMAP)) {
+        return top;
+    }
+
+    /*!< both side bitmap equal means free */
+    while (top && (util_map_test(bp->alloc_map, top - 1) == util_map_test(bp->free_map, top - 1))) {
+        top--;
+    }
+
+    if (top == atomic_load_explicit(&(bp->bump), memory_order_relaxed)) {
+        return top;
+    }
+
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        /*!< unlink trimmed block in place, link word may be unaligned */
+        for (addr = bp->free_list; NULL != addr; addr = next) {
+            memcpy(&next, addr, sizeof(void *));
+
+            if (util_index(bp, addr) < top) {
+                prev = addr;
+                continue;
+            }
+
+            if (NULL == prev) {
+                bp->free_list = next;
+            } else {
+                memcpy(prev, &next, sizeof(void *));
+            }
+
+            bp->free_cnt--;
+        }
+    } else {
+        /*!< pass every entry once, keep block below top */
+        for (cnt = util_free_cnt(bp); cnt > 0; cnt--) {
+            util_pop(bp, &addr);
+
+            if (util_index(bp, addr) < top) {
+                util_push(bp, addr);
+            }
+        }
     }
+
+    atomic_store_explicit(&(bp->bump), top, memory_order_relaxed);
+
+    return top;
 }
 
 /*****************************************************************************
@@ -140,7 +1020,7 @@ void chry_blockpool_reset(chry_blockpool_t *bp)
 *****************************************************************************/
 uint32_t chry_blockpool_get_size(chry_blockpool_t *bp)
 {
-    return bp->block_cnt;
+    return bp->block_cnt + util_region_blocks(bp);
 }
 
 /*****************************************************************************
@@ -152,7 +1032,7 @@ uint32_t chry_blockpool_get_size(chry_blockpool_t *bp)
 *****************************************************************************/
 uint32_t chry_blockpool_get_used(chry_blockpool_t *bp)
 {
-    return bp->block_cnt - chry_ringbuffer_get_used(&(bp->rb_free)) / sizeof(void *);
+    return bp->bump_limit + util_region_blocks(bp) - util_free_cnt(bp) - util_bump_cnt(bp);
 }
 
 /*****************************************************************************
@@ -164,7 +1044,7 @@ uint32_t chry_blockpool_get_used(chry_blockpool_t *bp)
 *****************************************************************************/
 uint32_t chry_blockpool_get_free(chry_blockpool_t *bp)
 {
-    return chry_ringbuffer_get_used(&(bp->rb_free)) / sizeof(void *);
+    return util_free_cnt(bp) + util_bump_cnt(bp);
 }
 
 /*****************************************************************************
@@ -177,13 +1057,28 @@ uint32_t chry_blockpool_get_free(chry_blockpool_t *bp)
 *****************************************************************************/
 bool chry_blockpool_check_nomem(chry_blockpool_t *bp)
 {
-    return chry_ringbuffer_check_empty(&(bp->rb_free));
+    if (util_bump_cnt(bp)) {
+        return false;
+    }
+
+    /*!< remote freed block reclaimed by next alloc */
+    if (NULL != atomic_load_explicit(&(bp->remote_list), memory_order_relaxed)) {
+        return false;
+    }
+
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        return (NULL == bp->free_list);
+    }
+
+    return atomic_load_explicit(&(bp->in), memory_order_acquire) == atomic_load_explicit(&(bp->out), memory_order_relaxed);
 }
 
 /*****************************************************************************
 * @brief        alloc one block from blockpool,
 *               should be add lock in mutithread,
-*               in single alloc thread not need lock
+*               lifo mode alloc and free share list, need lock,
+*               in single alloc thread not need lock,
+*               remote mode reclaim remote list when dry
 * 
 * @param[in]    bp          blockpool instance
 * @param[in]    addr        pointer to save alloc block pointer
@@ -192,97 +1087,301 @@ bool chry_blockpool_check_nomem(chry_blockpool_t *bp)
 *****************************************************************************/
 int chry_blockpool_alloc(chry_blockpool_t *bp, void **addr)
 {
-    if (sizeof(void *) != chry_ringbuffer_read(&(bp->rb_free), addr, sizeof(void *))) {
-        return -1;
+    /*!< local dry, reclaim remote freed blocks in one batch before bump */
+    if (util_pop(bp, addr) && (!util_reclaim(bp) || util_pop(bp, addr))) {
+        /*!< no freed block, take never used block */
+        if (0 == util_bump_cnt(bp)) {
+            return -1;
+        }
+
+        util_bump(bp, addr, 1);
+        return 0;
+    }
+
+    /*!< alloc side toggle, block state differ from free side */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        util_map_toggle(bp->alloc_map, util_index(bp, *addr));
     }
 
     return 0;
 }
 
-static uint32_t util_read(chry_ringbuffer_t *rb, uint32_t *out, void *data, uint32_t size)
+/*****************************************************************************
+* @brief        free one block from blockpool,
+*               should be add lock in mutithread,
+*               lifo mode alloc and free share list, need lock,
+*               in single free thread not need lock,
+*               mpsc mode free from many thread not need lock,
+*               mpsc mode detect already free only with bitmap
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr
+* @retval int               -2:Already free
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_blockpool_free(chry_blockpool_t *bp, void *addr)
 {
-    uint32_t used;
-    uint32_t offset;
-    uint32_t remain;
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(bp->pool);
+    uint32_t out = atomic_load_explicit(&(bp->out), memory_order_relaxed);
+    uint32_t idx = chry_blockpool_calc_index(address, bp->block_size, bp->block_shift, bp->block_inv, bp->block_cnt);
+
+    /*!< check is addr is our block, outside first region look up extra region */
+    if (idx < bp->block_cnt) {
+        /*!< never used block is free */
+        if (idx >= atomic_load_explicit(&(bp->bump), memory_order_relaxed)) {
+            return -2;
+        }
+    } else if ((address < (uintptr_t)bp->block_cnt * bp->block_size) || util_region_check(bp, addr)) {
+        return -1;
+    }
 
-    used = rb->in - *out;
-    if (size > used) {
-        size = used;
+    /*!< check is addr is already free */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        if (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC) {
+            if (util_map_claim(bp, idx)) {
+                return -2;
+            }
+        } else if (util_map_test(bp->alloc_map, idx) == util_map_test(bp->free_map, idx)) {
+            return -2;
+        }
+    } else if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        for (void *block = bp->free_list; NULL != block; memcpy(&block, block, sizeof(void *))) {
+            if (block == addr) {
+                return -2;
+            }
+        }
+    } else if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC)) {
+        /*!< mpsc mode other free thread rewrite entry alloc passed, scan only when we are the only writer */
+        for (uint32_t in = atomic_load_explicit(&(bp->in), memory_order_acquire); out != in; out += bp->entry_size) {
+            if (util_load(bp, out & bp->rb_mask) == addr) {
+                return -2;
+            }
+        }
     }
 
-    offset = *out & rb->mask;
+    /*!< check is free success */
+    if (util_push(bp, addr)) {
+        /*!< mpsc mode undo claimed free side bit */
+        if ((bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) && (bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC)) {
+            util_map_release(bp, idx);
+        }
 
-    remain = rb->mask + 1 - offset;
-    remain = remain > size ? size : remain;
+        return -3;
+    }
 
-    memcpy(data, ((uint8_t *)(rb->pool)) + offset, remain);
-    memcpy((uint8_t *)data + remain, rb->pool, size - remain);
+    /*!< free side toggle, block state equal to alloc side */
+    if ((bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) && !(bp->flags & CHRY_BLOCKPOOL_FLAG_MPSC)) {
+        util_map_toggle(bp->free_map, idx);
+    }
 
-    *out += size;
+    util_notify(bp);
 
-    return size;
+    return 0;
 }
 
 /*****************************************************************************
-* @brief        free one block from blockpool,
+* @brief        free one block from blockpool without check,
 *               should be add lock in mutithread,
-*               in single free thread not need lock
+*               lifo mode alloc and free share list, need lock,
+*               in single free thread not need lock,
+*               mpsc mode free from many thread not need lock
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+*****************************************************************************/
+void chry_blockpool_free_fast(chry_blockpool_t *bp, void *addr)
+{
+    util_push(bp, addr);
+
+    /*!< keep bitmap in step for later checked free */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        util_map_release(bp, util_index(bp, addr));
+    }
+
+    util_notify(bp);
+}
+
+/*****************************************************************************
+* @brief        free one block from non owner thread to remote list,
+*               lock free, never touch owner free ringbuffer,
+*               owner reclaim remote list in one batch when alloc run dry,
+*               remote freed block count as used until reclaimed,
+*               remote mode only, double free is not checked,
+*               without mpsc the owner thread alone alloc and local free
 * 
 * @param[in]    bp          blockpool instance
 * @param[in]    addr        pointer to free block
 * 
 * @retval int               0:Success 
 * @retval int               -1:Error addr
-* @retval int               -2:Already free
-* @retval int               -3:Error
+* @retval int               -3:Error, not remote mode
 *****************************************************************************/
-int chry_blockpool_free(chry_blockpool_t *bp, void *addr)
+int chry_blockpool_free_remote(chry_blockpool_t *bp, void *addr)
 {
-    void *block;
-    uintptr_t pool = (uintptr_t)(bp->pool);
-    uintptr_t address = (uintptr_t)addr;
-    uint32_t out = bp->rb_free.out;
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(bp->pool);
+    void *head;
 
-    /*!< check is addr is our block */
-    if (address < pool) {
+    if (!(bp->flags & CHRY_BLOCKPOOL_FLAG_REMOTE)) {
+        return -3;
+    }
+
+    /*!< same address check as checked free */
+    if ((chry_blockpool_calc_index(address, bp->block_size, bp->block_shift, bp->block_inv, bp->block_cnt) >= bp->block_cnt) &&
+        ((address < (uintptr_t)bp->block_cnt * bp->block_size) || util_region_check(bp, addr))) {
         return -1;
     }
 
-    address -= pool;
+#ifdef CHRY_BLOCKPOOL_WAIT
+    /*!< count before push, reclaim never subtract a block not yet counted */
+    atomic_fetch_add_explicit(&(bp->remote_cnt), 1, memory_order_relaxed);
+#endif
 
-    if (address % bp->block_size) {
-        return -1;
+    /*!< push only, owner take whole list by exchange, no ABA */
+    head = atomic_load_explicit(&(bp->remote_list), memory_order_relaxed);
+
+    do {
+        memcpy(addr, &head, sizeof(void *));
+    } while (!atomic_compare_exchange_weak_explicit(&(bp->remote_list), &head, addr, memory_order_release, memory_order_relaxed));
+
+    util_notify(bp);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        alloc n blocks from blockpool, all or nothing,
+*               free ringbuffer read pointer update once,
+*               should be add lock in mutithread,
+*               lifo mode alloc and free share list, need lock,
+*               in single alloc thread not need lock
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addrs       array to save n alloc block pointer
+* @param[in]    n           block count
+* 
+* @retval int               0:Success -1:Nomem, nothing alloced
+*****************************************************************************/
+int chry_blockpool_alloc_bulk(chry_blockpool_t *bp, void **addrs, uint32_t n)
+{
+    if (util_free_cnt(bp) < n) {
+        util_reclaim(bp);
     }
 
-    if ((address / bp->block_size) >= bp->block_cnt) {
+    if (util_free_cnt(bp) + util_bump_cnt(bp) < n) {
         return -1;
     }
 
-    /*!< check is addr is already free */
-    while (sizeof(void *) == util_read(&(bp->rb_free), &out, &block, sizeof(void *))) {
-        if (block == addr) {
-            return -2;
+    chry_blockpool_alloc_burst(bp, addrs, n);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        alloc up to n blocks from blockpool, best effort,
+*               free ringbuffer read pointer update once,
+*               should be add lock in mutithread,
+*               lifo mode alloc and free share list, need lock,
+*               in single alloc thread not need lock
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addrs       array to save alloc block pointer
+* @param[in]    n           max block count
+* 
+* @retval uint32_t          alloc block count
+*****************************************************************************/
+uint32_t chry_blockpool_alloc_burst(chry_blockpool_t *bp, void **addrs, uint32_t n)
+{
+    uint32_t cnt;
+    uint32_t bump_cnt = util_bump_cnt(bp);
+
+    if (util_free_cnt(bp) < n) {
+        util_reclaim(bp);
+    }
+
+    cnt = util_free_cnt(bp);
+
+    /*!< freed block first, then never used block */
+    cnt = n > cnt ? cnt : n;
+    bump_cnt = (n - cnt) > bump_cnt ? bump_cnt : (n - cnt);
+
+    util_pop_bulk(bp, addrs, cnt);
+
+    /*!< alloc side toggle, block state differ from free side */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        for (uint32_t i = 0; i < cnt; i++) {
+            util_map_toggle(bp->alloc_map, util_index(bp, addrs[i]));
         }
     }
 
-    /*!< check is free success */
-    if (sizeof(void *) != chry_ringbuffer_write(&(bp->rb_free), &addr, sizeof(void *))) {
-        return -3;
+    util_bump(bp, addrs + cnt, bump_cnt);
+
+    return cnt + bump_cnt;
+}
+
+/*****************************************************************************
+* @brief        free n blocks to blockpool without check, all or nothing,
+*               free ringbuffer write pointer update once,
+*               should be add lock in mutithread,
+*               lifo mode alloc and free share list, need lock,
+*               in single free thread not need lock,
+*               mpsc mode free from many thread not need lock
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addrs       array of n block pointer to free
+* @param[in]    n           block count
+* 
+* @retval int               0:Success -1:Error, nothing freed
+*****************************************************************************/
+int chry_blockpool_free_bulk(chry_blockpool_t *bp, void *const *addrs, uint32_t n)
+{
+    if (util_push_bulk(bp, addrs, n, true) != n) {
+        return -1;
+    }
+
+    /*!< keep bitmap in step for later checked free */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        for (uint32_t i = 0; i < n; i++) {
+            util_map_release(bp, util_index(bp, addrs[i]));
+        }
     }
 
+    util_notify(bp);
+
     return 0;
 }
 
 /*****************************************************************************
-* @brief        free one block from blockpool without check,
+* @brief        free up to n blocks to blockpool without check, best effort,
+*               free ringbuffer write pointer update once,
 *               should be add lock in mutithread,
-*               in single free thread not need lock
+*               lifo mode alloc and free share list, need lock,
+*               in single free thread not need lock,
+*               mpsc mode free from many thread not need lock
 * 
 * @param[in]    bp          blockpool instance
-* @param[in]    addr        pointer to free block
+* @param[in]    addrs       array of block pointer to free
+* @param[in]    n           max block count
 * 
+* @retval uint32_t          freed block count, from head of addrs
 *****************************************************************************/
-void chry_blockpool_free_fast(chry_blockpool_t *bp, void *addr)
+uint32_t chry_blockpool_free_burst(chry_blockpool_t *bp, void *const *addrs, uint32_t n)
 {
-    chry_ringbuffer_write(&(bp->rb_free), &addr, sizeof(void *));
+    n = util_push_bulk(bp, addrs, n, false);
+
+    /*!< keep bitmap in step for later checked free */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        for (uint32_t i = 0; i < n; i++) {
+            util_map_release(bp, util_index(bp, addrs[i]));
+        }
+    }
+
+    if (n) {
+        util_notify(bp);
+    }
+
+    return n;
 }
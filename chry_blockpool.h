@@ -7,13 +7,26 @@
 #ifndef CHRY_BLOCKPOOL_H
 #define CHRY_BLOCKPOOL_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool_config.h"
+
+/*!< C11 atomic in public struct, C++ see std::atomic of same size and lock-free layout */
 #ifdef __cplusplus
-extern "C" {
+extern "C++" {
+#include <atomic>
+}
+#define CHRY_BLOCKPOOL_ATOMIC(type) std::atomic<type>
+#define CHRY_BLOCKPOOL_ATOMIC_FLAG  std::atomic_flag
+#else
+#include <stdatomic.h>
+#define CHRY_BLOCKPOOL_ATOMIC(type) _Atomic(type)
+#define CHRY_BLOCKPOOL_ATOMIC_FLAG  atomic_flag
 #endif
 
-#include <stdint.h>
-#include <stdbool.h>
-#include "chry_ringbuffer.h"
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 #define CHRY_BLOCKPOOL_ALIGN_4    0x02
 #define CHRY_BLOCKPOOL_ALIGN_8    0x03
@@ -27,15 +40,88 @@ extern "C" {
 #define CHRY_BLOCKPOOL_ALIGN_2048 0x0B
 #define CHRY_BLOCKPOOL_ALIGN_4096 0x0C
 
+#define CHRY_BLOCKPOOL_FLAG_BITMAP 0x01 /*!< Track block state in bitmap, O(1) double free check */
+#define CHRY_BLOCKPOOL_FLAG_INDEX  0x02 /*!< Free ringbuffer holds 16/32 bit block index, not pointer */
+#define CHRY_BLOCKPOOL_FLAG_LIFO   0x04 /*!< Free blocks linked through first word, no ringbuffer */
+#define CHRY_BLOCKPOOL_FLAG_LAZY   0x08 /*!< O(1) init and reset, never used blocks from bump index */
+#define CHRY_BLOCKPOOL_FLAG_MPSC   0x10 /*!< Many free thread, one alloc thread, free reserve by CAS, double free check need BITMAP */
+#define CHRY_BLOCKPOOL_FLAG_REMOTE 0x20 /*!< Other thread free to remote list, owner reclaim when dry, owner alone alloc and local free unless MPSC */
+
+/*!< CHRY_BLOCKPOOL_CACHE_LINE in chry_blockpool_config.h, alloc side and free side index never share a line */
+#ifdef CHRY_BLOCKPOOL_CACHE_LINE
+#define CHRY_BLOCKPOOL_PAD(n) uint8_t pad##n[CHRY_BLOCKPOOL_CACHE_LINE];
+#else
+#define CHRY_BLOCKPOOL_PAD(n)
+#endif
+
+/*!< CHRY_BLOCKPOOL_WAIT in chry_blockpool_config.h, enable alloc_wait and eventfd readiness, free check one flag for waiter */
+
+/*!< CHRY_BLOCKPOOL_REGION_MAX in chry_blockpool_config.h, extra region count, enable chry_blockpool_add_region */
+typedef struct {
+    void *pool;                /*!< Define the region block memory.   */
+    uint32_t block_cnt;        /*!< Define the region block count.    */
+} chry_blockpool_region_t;
+
 typedef struct {
     uint32_t block_cnt;        /*!< Define the block count.           */
     uint32_t block_size;       /*!< Define the aligned block size.    */
+    uint32_t block_shift;      /*!< Define the block size power of 2. */
+    uint32_t block_inv;        /*!< Define the block size odd inverse. */
+    uint32_t flags;            /*!< Define the blockpool flags.       */
+    uint32_t entry_size;       /*!< Define the free entry size.       */
     void *pool;                /*!< Define the memory pointer.        */
-    chry_ringbuffer_t rb_free; /*!< Define the free block ringbuffer. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) *alloc_map; /*!< Define the alloc side bitmap.   */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) *free_map;  /*!< Define the free side bitmap.    */
+    void *rb_pool;             /*!< Define the free ringbuffer memory. */
+    uint32_t rb_mask;          /*!< Define the free ringbuffer mask.  */
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    uint32_t region_cnt;       /*!< Define the extra region count.    */
+    uint32_t region_blocks;    /*!< Define the extra region block count. */
+    chry_blockpool_region_t regions[CHRY_BLOCKPOOL_REGION_MAX]; /*!< Define the extra region sorted by address. */
+#endif
+    CHRY_BLOCKPOOL_PAD(0)
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) out;      /*!< Define the alloc side read pointer. */
+    uint32_t in_cache;         /*!< Define the alloc side write pointer copy. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) bump;     /*!< Define the first never used block. */
+    uint32_t bump_limit;       /*!< Define the lazy mode usable block limit. */
+    void *free_list;           /*!< Define the lifo free block list.  */
+    uint32_t free_cnt;         /*!< Define the lifo free block count. */
+    CHRY_BLOCKPOOL_PAD(1)
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) in;       /*!< Define the free side write pointer. */
+    uint32_t out_cache;        /*!< Define the free side read pointer copy. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) head;     /*!< Define the mpsc free reserve pointer. */
+    CHRY_BLOCKPOOL_PAD(2)
+    CHRY_BLOCKPOOL_ATOMIC(void *) remote_list; /*!< Define the remote free block list. */
+#ifdef CHRY_BLOCKPOOL_WAIT
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) waiters;  /*!< Define the sleeper and armed event count. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) sleepers; /*!< Define the sleeping alloc count.  */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) wake_seq; /*!< Define the futex word bumped by free. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) armed;    /*!< Define the event armed flag.      */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) remote_cnt; /*!< Define the remote list block count. */
+    uint32_t low_water;        /*!< Define the event free block mark. */
+    int event_fd;              /*!< Define the readiness eventfd.     */
+#endif
 } chry_blockpool_t;
 
+typedef struct {
+    uint32_t block_cnt;  /*!< Define the block count.                 */
+    uint32_t block_size; /*!< Define the aligned block size.          */
+    uint32_t entry_size; /*!< Define the free entry size.             */
+    uint32_t map_size;   /*!< Define the bitmap size in byte.         */
+    uint32_t rb_offset;  /*!< Define the free ringbuffer offset.      */
+    uint32_t rb_size;    /*!< Define the free ringbuffer size in byte. */
+    uint32_t waste_size; /*!< Define the unused size in byte.         */
+} chry_blockpool_layout_t;
+
+extern void chry_blockpool_calc_inverse(uint32_t block_size, uint32_t *shift, uint32_t *inv);
+extern void chry_blockpool_calc_reciprocal(uint32_t divisor, uint32_t *mul, uint32_t *shift);
+extern int chry_blockpool_calc_layout(chry_blockpool_layout_t *layout, uint32_t align, uint32_t block_size, uint32_t size, uint32_t flags);
 extern int chry_blockpool_init(chry_blockpool_t *bp, uint32_t align, uint32_t block_size, void *pool, uint32_t size);
+extern int chry_blockpool_init_ex(chry_blockpool_t *bp, uint32_t align, uint32_t block_size, void *pool, uint32_t size, uint32_t flags);
+extern int chry_blockpool_add_region(chry_blockpool_t *bp, void *pool, uint32_t size);
 extern void chry_blockpool_reset(chry_blockpool_t *bp);
+extern int chry_blockpool_set_limit(chry_blockpool_t *bp, uint32_t limit);
+extern uint32_t chry_blockpool_trim(chry_blockpool_t *bp);
 
 extern uint32_t chry_blockpool_get_size(chry_blockpool_t *bp);
 extern uint32_t chry_blockpool_get_used(chry_blockpool_t *bp);
@@ -46,9 +132,55 @@ extern bool chry_blockpool_check_nomem(chry_blockpool_t *bp);
 extern int chry_blockpool_alloc(chry_blockpool_t *bp, void **addr);
 extern int chry_blockpool_free(chry_blockpool_t *bp, void *addr);
 extern void chry_blockpool_free_fast(chry_blockpool_t *bp, void *addr);
+extern int chry_blockpool_free_remote(chry_blockpool_t *bp, void *addr);
+
+extern int chry_blockpool_alloc_bulk(chry_blockpool_t *bp, void **addrs, uint32_t n);
+extern uint32_t chry_blockpool_alloc_burst(chry_blockpool_t *bp, void **addrs, uint32_t n);
+extern int chry_blockpool_free_bulk(chry_blockpool_t *bp, void *const *addrs, uint32_t n);
+extern uint32_t chry_blockpool_free_burst(chry_blockpool_t *bp, void *const *addrs, uint32_t n);
+
+/*****************************************************************************
+* @brief        block index of an offset into a block area, shared free check,
+*               shift and inv from chry_blockpool_calc_inverse
+* 
+* @param[in]    offset      addr minus area start, below start wrap to large
+* @param[in]    block_size  block size in byte
+* @param[in]    shift       block size power of 2
+* @param[in]    inv         block size odd inverse
+* @param[in]    cnt         block count of area
+* 
+* @retval uint32_t          block index, cnt or more when not a block start
+*****************************************************************************/
+static inline uint32_t chry_blockpool_calc_index(uintptr_t offset, uint32_t block_size, uint32_t shift, uint32_t inv, uint32_t cnt)
+{
+    /*!< low bits clear, odd part exact divide by inverse multiply, non multiple go out of range */
+    if ((offset >= (uintptr_t)cnt * block_size) || (offset & ((0x1UL << shift) - 1))) {
+        return cnt;
+    }
+
+    return ((uint32_t)offset >> shift) * inv;
+}
+
+/*****************************************************************************
+* @brief        quotient of any dividend without divide,
+*               mul and shift from chry_blockpool_calc_reciprocal
+* 
+* @param[in]    n           dividend
+* @param[in]    mul         divisor reciprocal low 32 bit
+* @param[in]    shift       divisor round up power of 2
+* 
+* @retval uint32_t          n / divisor
+*****************************************************************************/
+static inline uint32_t chry_blockpool_calc_quotient(uint32_t n, uint32_t mul, uint32_t shift)
+{
+    /*!< high half of 33 bit multiply, implied top bit added back without overflow */
+    uint32_t t = (uint32_t)(((uint64_t)n * mul) >> 32);
+
+    return shift ? ((t + ((n - t) >> 1)) >> (shift - 1)) : n;
+}
 
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
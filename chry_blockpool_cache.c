@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_blockpool_cache.h"
+
+static void util_lock(chry_blockpool_depot_t *depot)
+{
+    while (atomic_flag_test_and_set_explicit(&(depot->lock), memory_order_acquire)) {
+    }
+}
+
+static void util_unlock(chry_blockpool_depot_t *depot)
+{
+    atomic_flag_clear_explicit(&(depot->lock), memory_order_release);
+}
+
+static chry_blockpool_mag_t *util_mag_pop(chry_blockpool_mag_t **list)
+{
+    chry_blockpool_mag_t *mag = *list;
+
+    if (NULL != mag) {
+        *list = mag->next;
+    }
+
+    return mag;
+}
+
+static void util_mag_push(chry_blockpool_mag_t **list, chry_blockpool_mag_t *mag)
+{
+    mag->next = *list;
+    *list = mag;
+}
+
+static void util_mag_swap(chry_blockpool_cache_t *cache)
+{
+    chry_blockpool_mag_t *mag = cache->loaded;
+
+    cache->loaded = cache->prev;
+    cache->prev = mag;
+}
+
+/*****************************************************************************
+* @brief        init magazine depot over a blockpool,
+*               magazines are carved from mem, each hold mag_size blocks
+* 
+* @param[in]    depot       depot instance
+* @param[in]    bp          backing blockpool, only touched under depot lock
+* @param[in]    mag_size    block count per magazine
+* @param[in]    mem         magazine memory, pointer aligned
+* @param[in]    size        magazine memory size in byte,
+*                           CHRY_BLOCKPOOL_MAG_SIZE(mag_size) per magazine,
+*                           two magazines per thread cache plus spare for depot
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_depot_init(chry_blockpool_depot_t *depot, chry_blockpool_t *bp, uint32_t mag_size, void *mem, uint32_t size)
+{
+    uint32_t mag_bytes = CHRY_BLOCKPOOL_MAG_SIZE(mag_size);
+
+    if ((0 == mag_size) || (size < mag_bytes * 2)) {
+        return -1;
+    }
+
+    depot->bp = bp;
+    depot->mag_size = mag_size;
+    depot->full = NULL;
+    depot->empty = NULL;
+    atomic_flag_clear(&(depot->lock));
+
+    for (uint32_t i = 0; i < size / mag_bytes; i++) {
+        chry_blockpool_mag_t *mag = (chry_blockpool_mag_t *)((uintptr_t)mem + i * mag_bytes);
+
+        mag->cnt = 0;
+        util_mag_push(&(depot->empty), mag);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        return blocks in depot full magazines to blockpool,
+*               thread caches are not touched
+* 
+* @param[in]    depot       depot instance
+* 
+*****************************************************************************/
+void chry_blockpool_depot_drain(chry_blockpool_depot_t *depot)
+{
+    chry_blockpool_mag_t *mag;
+
+    util_lock(depot);
+
+    while (NULL != (mag = util_mag_pop(&(depot->full)))) {
+        chry_blockpool_free_bulk(depot->bp, mag->rounds, mag->cnt);
+        mag->cnt = 0;
+        util_mag_push(&(depot->empty), mag);
+    }
+
+    util_unlock(depot);
+}
+
+/*****************************************************************************
+* @brief        init thread cache, take two empty magazines from depot,
+*               cache must only be used by its own thread
+* 
+* @param[in]    cache       thread cache instance
+* @param[in]    depot       shared depot
+* 
+* @retval int               0:Success -1:No magazine in depot
+*****************************************************************************/
+int chry_blockpool_cache_init(chry_blockpool_cache_t *cache, chry_blockpool_depot_t *depot)
+{
+    cache->depot = depot;
+
+    util_lock(depot);
+
+    cache->loaded = util_mag_pop(&(depot->empty));
+    cache->prev = util_mag_pop(&(depot->empty));
+
+    if ((NULL == cache->loaded) || (NULL == cache->prev)) {
+        if (NULL != cache->loaded) {
+            util_mag_push(&(depot->empty), cache->loaded);
+        }
+
+        cache->loaded = NULL;
+        cache->prev = NULL;
+        util_unlock(depot);
+        return -1;
+    }
+
+    util_unlock(depot);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        flush thread cache, call at thread exit,
+*               held blocks go back to blockpool, magazines back to depot
+* 
+* @param[in]    cache       thread cache instance
+* 
+*****************************************************************************/
+void chry_blockpool_cache_flush(chry_blockpool_cache_t *cache)
+{
+    chry_blockpool_depot_t *depot = cache->depot;
+
+    if (NULL == cache->loaded) {
+        return;
+    }
+
+    util_lock(depot);
+
+    chry_blockpool_free_bulk(depot->bp, cache->loaded->rounds, cache->loaded->cnt);
+    chry_blockpool_free_bulk(depot->bp, cache->prev->rounds, cache->prev->cnt);
+    cache->loaded->cnt = 0;
+    cache->prev->cnt = 0;
+    util_mag_push(&(depot->empty), cache->loaded);
+    util_mag_push(&(depot->empty), cache->prev);
+
+    util_unlock(depot);
+
+    cache->loaded = NULL;
+    cache->prev = NULL;
+}
+
+/*****************************************************************************
+* @brief        alloc one block through thread cache,
+*               most call touch only thread own magazine
+* 
+* @param[in]    cache       thread cache instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_cache_alloc(chry_blockpool_cache_t *cache, void **addr)
+{
+    chry_blockpool_depot_t *depot = cache->depot;
+    chry_blockpool_mag_t *mag;
+
+    if (cache->loaded->cnt) {
+        *addr = cache->loaded->rounds[--cache->loaded->cnt];
+        return 0;
+    }
+
+    /*!< loaded empty, previous has block */
+    if (cache->prev->cnt) {
+        util_mag_swap(cache);
+        *addr = cache->loaded->rounds[--cache->loaded->cnt];
+        return 0;
+    }
+
+    util_lock(depot);
+
+    mag = util_mag_pop(&(depot->full));
+
+    if (NULL != mag) {
+        /*!< both empty, trade one for a full magazine */
+        util_mag_push(&(depot->empty), cache->prev);
+        cache->prev = cache->loaded;
+        cache->loaded = mag;
+    } else {
+        /*!< depot has no full magazine, refill from blockpool in one batch */
+        cache->loaded->cnt = chry_blockpool_alloc_burst(depot->bp, cache->loaded->rounds, depot->mag_size);
+    }
+
+    util_unlock(depot);
+
+    if (0 == cache->loaded->cnt) {
+        return -1;
+    }
+
+    *addr = cache->loaded->rounds[--cache->loaded->cnt];
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        free one block through thread cache without check,
+*               most call touch only thread own magazine
+* 
+* @param[in]    cache       thread cache instance
+* @param[in]    addr        pointer to free block
+* 
+*****************************************************************************/
+void chry_blockpool_cache_free(chry_blockpool_cache_t *cache, void *addr)
+{
+    chry_blockpool_depot_t *depot = cache->depot;
+    chry_blockpool_mag_t *mag;
+
+    if (cache->loaded->cnt < depot->mag_size) {
+        cache->loaded->rounds[cache->loaded->cnt++] = addr;
+        return;
+    }
+
+    /*!< loaded full, previous has room */
+    if (cache->prev->cnt < depot->mag_size) {
+        util_mag_swap(cache);
+        cache->loaded->rounds[cache->loaded->cnt++] = addr;
+        return;
+    }
+
+    util_lock(depot);
+
+    mag = util_mag_pop(&(depot->empty));
+
+    if (NULL != mag) {
+        /*!< both full, trade one for an empty magazine */
+        util_mag_push(&(depot->full), cache->prev);
+        cache->prev = cache->loaded;
+        cache->loaded = mag;
+    } else {
+        /*!< depot has no empty magazine, drain to blockpool in one batch */
+        chry_blockpool_free_bulk(depot->bp, cache->loaded->rounds, cache->loaded->cnt);
+        cache->loaded->cnt = 0;
+    }
+
+    util_unlock(depot);
+
+    cache->loaded->rounds[cache->loaded->cnt++] = addr;
+}
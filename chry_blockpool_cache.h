@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_CACHE_H
+#define CHRY_BLOCKPOOL_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+typedef struct chry_blockpool_mag {
+    struct chry_blockpool_mag *next; /*!< Define the next magazine in depot. */
+    uint32_t cnt;                    /*!< Define the block count held.      */
+    void *rounds[];                  /*!< Define the block pointer stack.   */
+} chry_blockpool_mag_t;
+
+typedef struct {
+    chry_blockpool_t *bp;            /*!< Define the backing blockpool.      */
+    uint32_t mag_size;               /*!< Define the rounds per magazine.    */
+    CHRY_BLOCKPOOL_ATOMIC_FLAG lock; /*!< Define the depot and pool lock.    */
+    chry_blockpool_mag_t *full;      /*!< Define the full magazine list.     */
+    chry_blockpool_mag_t *empty;     /*!< Define the empty magazine list.    */
+} chry_blockpool_depot_t;
+
+typedef struct {
+    chry_blockpool_depot_t *depot; /*!< Define the shared depot.          */
+    chry_blockpool_mag_t *loaded;  /*!< Define the magazine in use.       */
+    chry_blockpool_mag_t *prev;    /*!< Define the previous magazine.     */
+} chry_blockpool_cache_t;
+
+#define CHRY_BLOCKPOOL_MAG_SIZE(mag_size) (sizeof(chry_blockpool_mag_t) + (mag_size) * sizeof(void *))
+
+extern int chry_blockpool_depot_init(chry_blockpool_depot_t *depot, chry_blockpool_t *bp, uint32_t mag_size, void *mem, uint32_t size);
+extern void chry_blockpool_depot_drain(chry_blockpool_depot_t *depot);
+
+extern int chry_blockpool_cache_init(chry_blockpool_cache_t *cache, chry_blockpool_depot_t *depot);
+extern void chry_blockpool_cache_flush(chry_blockpool_cache_t *cache);
+
+extern int chry_blockpool_cache_alloc(chry_blockpool_cache_t *cache, void **addr);
+extern void chry_blockpool_cache_free(chry_blockpool_cache_t *cache, void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_CONFIG_H
+#define CHRY_BLOCKPOOL_CONFIG_H
+
+/**
+ * Options below change the chry_blockpool_t layout, every file include
+ * chry_blockpool.h must see the same value, so set them here, not per file
+ */
+
+/*!< cache line size, alloc side and free side index never share a line */
+/* #define CHRY_BLOCKPOOL_CACHE_LINE 64 */
+
+/*!< extra region count, enable chry_blockpool_add_region */
+/* #define CHRY_BLOCKPOOL_REGION_MAX 4 */
+
+/*!< enable alloc_wait and eventfd readiness, build chry_blockpool_wait.c, Linux */
+/* #define CHRY_BLOCKPOOL_WAIT */
+
+#endif
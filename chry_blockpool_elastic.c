@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include "chry_blockpool_elastic.h"
+
+static int util_resize(chry_blockpool_elastic_t *ep, uint32_t size)
+{
+    uint8_t *base = (uint8_t *)(ep->base);
+
+    /*!< block area below metadata only, metadata stay committed */
+    size = size > ep->meta_offset ? ep->meta_offset : size;
+
+    if (size > ep->commit_size) {
+        if (mprotect(base + ep->commit_size, size - ep->commit_size, PROT_READ | PROT_WRITE)) {
+            return -1;
+        }
+    } else if (size < ep->commit_size) {
+        /*!< drop page first, then take away commit charge */
+        madvise(base + size, ep->commit_size - size, MADV_DONTNEED);
+
+        if (mprotect(base + size, ep->commit_size - size, PROT_NONE)) {
+            return -1;
+        }
+    }
+
+    ep->commit_size = size;
+
+    /*!< last block may run into metadata page, already committed */
+    return chry_blockpool_set_limit(&(ep->bp), (size == ep->meta_offset) ? ep->bp.block_cnt : size / ep->bp.block_size);
+}
+
+/*****************************************************************************
+* @brief        init elastic blockpool, reserve virtual range without commit,
+*               commit metadata and first step of block area,
+*               lazy and bitmap flag always set
+* 
+* @param[in]    ep          elastic blockpool instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    reserve_size reserved range size in byte, peak capacity
+* @param[in]    step_size   grow step and minimum commit in byte
+* @param[in]    flags       CHRY_BLOCKPOOL_FLAG_xxx
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_elastic_init(chry_blockpool_elastic_t *ep, uint32_t align, uint32_t block_size, uint32_t reserve_size, uint32_t step_size, uint32_t flags)
+{
+    chry_blockpool_layout_t layout;
+    uint32_t page = (uint32_t)sysconf(_SC_PAGESIZE);
+
+    flags |= CHRY_BLOCKPOOL_FLAG_LAZY | CHRY_BLOCKPOOL_FLAG_BITMAP;
+
+    reserve_size = (reserve_size + page - 1) & ~(page - 1);
+    step_size = (step_size + page - 1) & ~(page - 1);
+
+    if ((0 == reserve_size) || (0 == step_size) || chry_blockpool_calc_layout(&layout, align, block_size, reserve_size, flags)) {
+        return -1;
+    }
+
+    ep->base = mmap(NULL, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (MAP_FAILED == ep->base) {
+        return -1;
+    }
+
+    ep->reserve_size = reserve_size;
+    ep->commit_size = 0;
+    ep->step_size = step_size;
+    ep->meta_offset = (layout.block_cnt * layout.block_size) & ~(page - 1);
+    ep->page_size = page;
+
+    /*!< bitmap and ringbuffer after block area, committed for whole capacity */
+    if (mprotect((uint8_t *)(ep->base) + ep->meta_offset, reserve_size - ep->meta_offset, PROT_READ | PROT_WRITE) ||
+        chry_blockpool_init_ex(&(ep->bp), align, block_size, ep->base, reserve_size, flags) ||
+        util_resize(ep, step_size)) {
+        munmap(ep->base, reserve_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        deinit elastic blockpool, release reserved range
+* 
+* @param[in]    ep          elastic blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_elastic_deinit(chry_blockpool_elastic_t *ep)
+{
+    munmap(ep->base, ep->reserve_size);
+}
+
+/*****************************************************************************
+* @brief        get committed block area size
+* 
+* @param[in]    ep          elastic blockpool instance
+* 
+* @retval uint32_t          committed size in byte
+*****************************************************************************/
+uint32_t chry_blockpool_elastic_get_commit(chry_blockpool_elastic_t *ep)
+{
+    return ep->commit_size;
+}
+
+/*****************************************************************************
+* @brief        alloc one block, commit one more step when run dry,
+*               same lock rule as chry_blockpool_alloc
+* 
+* @param[in]    ep          elastic blockpool instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_elastic_alloc(chry_blockpool_elastic_t *ep, void **addr)
+{
+    if (0 == chry_blockpool_alloc(&(ep->bp), addr)) {
+        return 0;
+    }
+
+    /*!< whole range committed, or commit refused */
+    if ((ep->commit_size == ep->meta_offset) ||
+        util_resize(ep, (ep->meta_offset - ep->commit_size > ep->step_size) ? ep->commit_size + ep->step_size : ep->meta_offset)) {
+        return -1;
+    }
+
+    return chry_blockpool_alloc(&(ep->bp), addr);
+}
+
+/*****************************************************************************
+* @brief        free one block, range and align check stay O(1),
+*               same lock rule as chry_blockpool_free
+* 
+* @param[in]    ep          elastic blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr
+* @retval int               -2:Already free
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_blockpool_elastic_free(chry_blockpool_elastic_t *ep, void *addr)
+{
+    return chry_blockpool_free(&(ep->bp), addr);
+}
+
+/*****************************************************************************
+* @brief        shrink elastic blockpool, trim free tail and decommit its page,
+*               keep at least one step committed,
+*               should be add lock in mutithread, no alloc nor free may run
+* 
+* @param[in]    ep          elastic blockpool instance
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_elastic_shrink(chry_blockpool_elastic_t *ep)
+{
+    uint32_t size = chry_blockpool_trim(&(ep->bp)) * ep->bp.block_size;
+
+    size = (size + ep->page_size - 1) & ~(ep->page_size - 1);
+    size = size < ep->step_size ? ep->step_size : size;
+
+    if (size >= ep->commit_size) {
+        return 0;
+    }
+
+    return util_resize(ep, size);
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_ELASTIC_H
+#define CHRY_BLOCKPOOL_ELASTIC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+typedef struct {
+    chry_blockpool_t bp;   /*!< Define the blockpool on reserved range. */
+    void *base;            /*!< Define the reserved range address.      */
+    uint32_t reserve_size; /*!< Define the reserved size in byte.       */
+    uint32_t commit_size;  /*!< Define the committed block area in byte. */
+    uint32_t step_size;    /*!< Define the grow step in byte.           */
+    uint32_t meta_offset;  /*!< Define the page aligned metadata offset. */
+    uint32_t page_size;    /*!< Define the system page size.            */
+} chry_blockpool_elastic_t;
+
+extern int chry_blockpool_elastic_init(chry_blockpool_elastic_t *ep, uint32_t align, uint32_t block_size, uint32_t reserve_size, uint32_t step_size, uint32_t flags);
+extern void chry_blockpool_elastic_deinit(chry_blockpool_elastic_t *ep);
+
+extern uint32_t chry_blockpool_elastic_get_commit(chry_blockpool_elastic_t *ep);
+
+extern int chry_blockpool_elastic_alloc(chry_blockpool_elastic_t *ep, void **addr);
+extern int chry_blockpool_elastic_free(chry_blockpool_elastic_t *ep, void *addr);
+extern int chry_blockpool_elastic_shrink(chry_blockpool_elastic_t *ep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
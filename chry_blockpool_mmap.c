@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "chry_blockpool_mmap.h"
+
+typedef struct {
+    volatile uint8_t *start; /*!< Define the touch range start.  */
+    size_t size;             /*!< Define the touch range size.   */
+    size_t step;             /*!< Define the touch stride.       */
+} util_touch_t;
+
+static size_t util_hugepage_size(void)
+{
+    FILE *fp = fopen("/proc/meminfo", "r");
+    unsigned long kb = 0;
+    char line[128];
+
+    if (NULL != fp) {
+        while (fgets(line, sizeof(line), fp)) {
+            if (1 == sscanf(line, "Hugepagesize: %lu kB", &kb)) {
+                break;
+            }
+        }
+
+        fclose(fp);
+    }
+
+    /*!< common x86_64 and arm64 default */
+    return kb ? (size_t)kb * 1024 : (size_t)2 * 1024 * 1024;
+}
+
+static void *util_touch(void *arg)
+{
+    util_touch_t *touch = (util_touch_t *)arg;
+
+    /*!< one write per page, page already zero */
+    for (size_t offset = 0; offset < touch->size; offset += touch->step) {
+        touch->start[offset] = 0;
+    }
+
+    return NULL;
+}
+
+static void util_touch_all(uint8_t *base, size_t size, size_t page)
+{
+    pthread_t threads[CHRY_BLOCKPOOL_MMAP_TOUCH_MAX];
+    util_touch_t touch[CHRY_BLOCKPOOL_MMAP_TOUCH_MAX];
+    long cpu = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t pages = size / page;
+    size_t cnt;
+    size_t chunk;
+    bool started[CHRY_BLOCKPOOL_MMAP_TOUCH_MAX];
+
+    cnt = (cpu < 1) ? 1 : ((size_t)cpu > CHRY_BLOCKPOOL_MMAP_TOUCH_MAX ? CHRY_BLOCKPOOL_MMAP_TOUCH_MAX : (size_t)cpu);
+    cnt = cnt > pages ? pages : cnt;
+
+    if (0 == cnt) {
+        return;
+    }
+
+    chunk = (pages + cnt - 1) / cnt;
+
+    for (size_t i = 0; i < cnt; i++) {
+        touch[i].start = base + i * chunk * page;
+        touch[i].size = (i == cnt - 1) ? (pages - i * chunk) * page : chunk * page;
+        touch[i].step = page;
+
+        /*!< thread refused, touch this range in place */
+        started[i] = (0 == pthread_create(&threads[i], NULL, util_touch, &touch[i]));
+
+        if (!started[i]) {
+            util_touch(&touch[i]);
+        }
+    }
+
+    for (size_t i = 0; i < cnt; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+}
+
+static void *util_map_aligned(size_t size, size_t align)
+{
+    uint8_t *raw;
+    uint8_t *base;
+
+    /*!< over map, trim head and tail to alignment */
+    raw = mmap(NULL, size + align, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (MAP_FAILED == raw) {
+        return MAP_FAILED;
+    }
+
+    base = (uint8_t *)(((uintptr_t)raw + align - 1) & ~(uintptr_t)(align - 1));
+
+    if (base != raw) {
+        munmap(raw, base - raw);
+    }
+
+    if ((size_t)(raw + align - base)) {
+        munmap(base + size, raw + align - base);
+    }
+
+    return base;
+}
+
+/*****************************************************************************
+* @brief        create blockpool on its own anonymous mapping,
+*               hugetlb page first when asked, else hugepage aligned base page
+*               mapping with transparent hugepage advice, optionally prefault
+*               so alloc never take page fault
+* 
+* @param[in]    mp          mmap blockpool instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    size        memory size in byte, round up to page
+* @param[in]    flags       CHRY_BLOCKPOOL_FLAG_xxx
+* @param[in]    map_flags   CHRY_BLOCKPOOL_MMAP_xxx
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_create_mmap(chry_blockpool_mmap_t *mp, uint32_t align, uint32_t block_size, uint32_t size, uint32_t flags, uint32_t map_flags)
+{
+    size_t huge = util_hugepage_size();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    int populate = (map_flags & CHRY_BLOCKPOOL_MMAP_POPULATE) ? MAP_POPULATE : 0;
+
+    mp->base = MAP_FAILED;
+    mp->hugetlb = false;
+
+    if (map_flags & CHRY_BLOCKPOOL_MMAP_HUGETLB) {
+        mp->map_size = ((size_t)size + huge - 1) & ~(huge - 1);
+        mp->base = mmap(NULL, mp->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        mp->hugetlb = (MAP_FAILED != mp->base);
+        mp->page_size = huge;
+    }
+
+    /*!< no hugetlb page reserved, fall back to base page */
+    if (MAP_FAILED == mp->base) {
+        mp->page_size = page;
+
+        if (map_flags & (CHRY_BLOCKPOOL_MMAP_THP | CHRY_BLOCKPOOL_MMAP_HUGETLB)) {
+            mp->map_size = ((size_t)size + huge - 1) & ~(huge - 1);
+            mp->base = util_map_aligned(mp->map_size, huge);
+
+#ifdef MADV_HUGEPAGE
+            /*!< advice only, thp disabled keep base page */
+            if (MAP_FAILED != mp->base) {
+                madvise(mp->base, mp->map_size, MADV_HUGEPAGE);
+            }
+#endif
+        } else {
+            mp->map_size = ((size_t)size + page - 1) & ~(page - 1);
+            mp->base = mmap(NULL, mp->map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+
+        if (MAP_FAILED == mp->base) {
+            return -1;
+        }
+
+        /*!< populate after advice so fault take hugepage, older kernel touch instead */
+        if (populate) {
+            int ret = -1;
+
+#ifdef MADV_POPULATE_WRITE
+            ret = madvise(mp->base, mp->map_size, MADV_POPULATE_WRITE);
+#endif
+
+            if (ret) {
+                map_flags |= CHRY_BLOCKPOOL_MMAP_TOUCH;
+            }
+        }
+    }
+
+    if (map_flags & CHRY_BLOCKPOOL_MMAP_TOUCH) {
+        util_touch_all((uint8_t *)(mp->base), mp->map_size, mp->page_size);
+    }
+
+    /*!< mapping larger than size after round up, pool keep caller size */
+    if (chry_blockpool_init_ex(&(mp->bp), align, block_size, mp->base, size, flags)) {
+        munmap(mp->base, mp->map_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        destroy mmap blockpool, release mapping
+* 
+* @param[in]    mp          mmap blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_destroy_mmap(chry_blockpool_mmap_t *mp)
+{
+    munmap(mp->base, mp->map_size);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_MMAP_H
+#define CHRY_BLOCKPOOL_MMAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+#define CHRY_BLOCKPOOL_MMAP_HUGETLB  0x01 /*!< Try hugetlbfs page first, MAP_HUGETLB */
+#define CHRY_BLOCKPOOL_MMAP_THP      0x02 /*!< Hugepage aligned, advise transparent hugepage */
+#define CHRY_BLOCKPOOL_MMAP_POPULATE 0x04 /*!< Prefault in kernel, MAP_POPULATE or MADV_POPULATE_WRITE */
+#define CHRY_BLOCKPOOL_MMAP_TOUCH    0x08 /*!< Prefault by multithread touch pass */
+
+/*!< touch pass thread count limit, online cpu count below it */
+#ifndef CHRY_BLOCKPOOL_MMAP_TOUCH_MAX
+#define CHRY_BLOCKPOOL_MMAP_TOUCH_MAX 16
+#endif
+
+typedef struct {
+    chry_blockpool_t bp; /*!< Define the blockpool on mapping.     */
+    void *base;          /*!< Define the mapping address.          */
+    size_t map_size;     /*!< Define the mapping size in byte.     */
+    size_t page_size;    /*!< Define the hugetlb or base page size. */
+    bool hugetlb;        /*!< Define the hugetlb page in use.      */
+} chry_blockpool_mmap_t;
+
+extern int chry_blockpool_create_mmap(chry_blockpool_mmap_t *mp, uint32_t align, uint32_t block_size, uint32_t size, uint32_t flags, uint32_t map_flags);
+extern void chry_blockpool_destroy_mmap(chry_blockpool_mmap_t *mp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_blockpool_mpmc.h"
+
+static int util_enqueue(chry_blockpool_mpmc_t *mp, uint32_t idx)
+{
+    chry_blockpool_cell_t *cell;
+    uint32_t pos = atomic_load_explicit(&(mp->in), memory_order_relaxed);
+
+    while (1) {
+        cell = &(mp->cells[pos & mp->mask]);
+
+        uint32_t seq = atomic_load_explicit(&(cell->seq), memory_order_acquire);
+        int32_t diff = (int32_t)(seq - pos);
+
+        if (0 == diff) {
+            /*!< cell is empty, claim it */
+            if (atomic_compare_exchange_weak_explicit(&(mp->in), &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /*!< cell still held by an alloc a lap ago, full only when every cell is taken */
+            if ((int32_t)(pos - atomic_load_explicit(&(mp->out), memory_order_relaxed)) > (int32_t)mp->mask) {
+                return -1;
+            }
+
+            pos = atomic_load_explicit(&(mp->in), memory_order_relaxed);
+        } else {
+            pos = atomic_load_explicit(&(mp->in), memory_order_relaxed);
+        }
+    }
+
+    cell->idx = idx;
+    atomic_store_explicit(&(cell->seq), pos + 1, memory_order_release);
+
+    return 0;
+}
+
+static int util_dequeue(chry_blockpool_mpmc_t *mp, uint32_t *idx)
+{
+    chry_blockpool_cell_t *cell;
+    uint32_t pos = atomic_load_explicit(&(mp->out), memory_order_relaxed);
+
+    while (1) {
+        cell = &(mp->cells[pos & mp->mask]);
+
+        uint32_t seq = atomic_load_explicit(&(cell->seq), memory_order_acquire);
+        int32_t diff = (int32_t)(seq - (pos + 1));
+
+        if (0 == diff) {
+            /*!< cell is filled, claim it */
+            if (atomic_compare_exchange_weak_explicit(&(mp->out), &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /*!< cell not yet filled, ring is empty */
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&(mp->out), memory_order_relaxed);
+        }
+    }
+
+    *idx = cell->idx;
+    atomic_store_explicit(&(cell->seq), pos + mp->mask + 1, memory_order_release);
+
+    return 0;
+}
+
+static uint32_t util_dequeue_burst(chry_blockpool_mpmc_t *mp, uint32_t *idx, uint32_t n)
+{
+    chry_blockpool_cell_t *cell;
+    uint32_t pos = atomic_load_explicit(&(mp->out), memory_order_relaxed);
+    uint32_t cnt;
+
+    while (1) {
+        cnt = 0;
+
+        /*!< count filled cells from pos, only an alloc move out can take them */
+        while (cnt < n) {
+            cell = &(mp->cells[(pos + cnt) & mp->mask]);
+
+            if (atomic_load_explicit(&(cell->seq), memory_order_acquire) != pos + cnt + 1) {
+                break;
+            }
+
+            cnt++;
+        }
+
+        if (cnt) {
+            /*!< claim all counted cells with one CAS */
+            if (atomic_compare_exchange_weak_explicit(&(mp->out), &pos, pos + cnt, memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if ((int32_t)(atomic_load_explicit(&(cell->seq), memory_order_relaxed) - (pos + 1)) < 0) {
+            /*!< first cell not yet filled, ring is empty */
+            return 0;
+        } else {
+            pos = atomic_load_explicit(&(mp->out), memory_order_relaxed);
+        }
+    }
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        cell = &(mp->cells[(pos + i) & mp->mask]);
+        idx[i] = cell->idx;
+        atomic_store_explicit(&(cell->seq), pos + i + mp->mask + 1, memory_order_release);
+    }
+
+    return cnt;
+}
+
+/*****************************************************************************
+* @brief        init lock-free multi producer multi consumer blockpool,
+*               block area then cell ring in memory pool
+* 
+* @param[in]    mp          mpmc blockpool instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    pool        memory pool address, align to 4 byte at least
+* @param[in]    size        memory size in byte
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_mpmc_init(chry_blockpool_mpmc_t *mp, uint32_t align, uint32_t block_size, void *pool, uint32_t size)
+{
+    uint32_t block_cnt = 0;
+    uint32_t cell_cnt = 0;
+
+    /*!< check param */
+    if ((0 == block_size) || (0 == size) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096)) {
+        return -1;
+    }
+
+    /*!< block size align up */
+    if (block_size & ((0x1 << align) - 1)) {
+        block_size = (block_size & (~((0x1 << align) - 1))) + (0x1 << align);
+    }
+
+    /*!< try each power of 2 cell count, keep the one fit most blocks */
+    for (uint32_t bit = 0; bit < 32; bit++) {
+        uint32_t cnt = 0x1UL << bit;
+
+        if ((uint64_t)cnt * sizeof(chry_blockpool_cell_t) >= size) {
+            break;
+        }
+
+        uint32_t fit = (size - cnt * sizeof(chry_blockpool_cell_t)) / block_size;
+        fit = fit > cnt ? cnt : fit;
+
+        if (fit > block_cnt) {
+            block_cnt = fit;
+            cell_cnt = cnt;
+        }
+    }
+
+    if (0 == block_cnt) {
+        return -1;
+    }
+
+    mp->block_cnt = block_cnt;
+    mp->block_size = block_size;
+    chry_blockpool_calc_inverse(block_size, &(mp->block_shift), &(mp->block_inv));
+    mp->mask = cell_cnt - 1;
+    mp->pool = pool;
+    mp->cells = (chry_blockpool_cell_t *)((uintptr_t)pool + block_cnt * block_size);
+
+    chry_blockpool_mpmc_reset(mp);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        reset mpmc blockpool, free all block,
+*               no thread should alloc or free at the time
+* 
+* @param[in]    mp          mpmc blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_mpmc_reset(chry_blockpool_mpmc_t *mp)
+{
+    /*!< first block_cnt cells hold block, rest empty for this lap */
+    for (uint32_t i = 0; i <= mp->mask; i++) {
+        mp->cells[i].idx = i;
+        atomic_init(&(mp->cells[i].seq), (i < mp->block_cnt) ? (i + 1) : i);
+    }
+
+    atomic_init(&(mp->in), mp->block_cnt);
+    atomic_init(&(mp->out), 0);
+}
+
+/*****************************************************************************
+* @brief        get mpmc blockpool total size in block count
+* 
+* @param[in]    mp          mpmc blockpool instance
+* 
+* @retval uint32_t          total size in block count
+*****************************************************************************/
+uint32_t chry_blockpool_mpmc_get_size(chry_blockpool_mpmc_t *mp)
+{
+    return mp->block_cnt;
+}
+
+/*****************************************************************************
+* @brief        get mpmc blockpool free size in block count,
+*               a snapshot only when other thread alloc or free
+* 
+* @param[in]    mp          mpmc blockpool instance
+* 
+* @retval uint32_t          free size in block count
+*****************************************************************************/
+uint32_t chry_blockpool_mpmc_get_free(chry_blockpool_mpmc_t *mp)
+{
+    uint32_t out = atomic_load_explicit(&(mp->out), memory_order_relaxed);
+    uint32_t in = atomic_load_explicit(&(mp->in), memory_order_relaxed);
+    int32_t used = (int32_t)(in - out);
+
+    return used < 0 ? 0 : (uint32_t)used;
+}
+
+/*****************************************************************************
+* @brief        alloc one block from mpmc blockpool,
+*               lock-free, any thread can call
+* 
+* @param[in]    mp          mpmc blockpool instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_mpmc_alloc(chry_blockpool_mpmc_t *mp, void **addr)
+{
+    uint32_t idx;
+
+    if (util_dequeue(mp, &idx)) {
+        return -1;
+    }
+
+    *addr = (void *)((uintptr_t)(mp->pool) + idx * mp->block_size);
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        alloc up to n blocks from mpmc blockpool, best effort,
+*               lock-free, any thread can call,
+*               up to 32 contiguous filled cells claimed by one CAS
+* 
+* @param[in]    mp          mpmc blockpool instance
+* @param[in]    addrs       array to save alloc block pointer
+* @param[in]    n           max block count
+* 
+* @retval uint32_t          alloc block count
+*****************************************************************************/
+uint32_t chry_blockpool_mpmc_alloc_burst(chry_blockpool_mpmc_t *mp, void **addrs, uint32_t n)
+{
+    uint32_t idx[32];
+    uint32_t total = 0;
+    uint32_t cnt;
+
+    if (0 == n) {
+        return 0;
+    }
+
+    /*!< claim in chunk of index buffer, stop at first short chunk */
+    do {
+        cnt = util_dequeue_burst(mp, idx, (n - total) > 32 ? 32 : (n - total));
+
+        for (uint32_t i = 0; i < cnt; i++) {
+            addrs[total + i] = (void *)((uintptr_t)(mp->pool) + idx[i] * mp->block_size);
+        }
+
+        total += cnt;
+    } while ((cnt == 32) && (total < n));
+
+    return total;
+}
+
+/*****************************************************************************
+* @brief        free one block to mpmc blockpool with address check,
+*               lock-free, any thread can call,
+*               double free is not checked
+* 
+* @param[in]    mp          mpmc blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success
+* @retval int               -1:Error addr
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_blockpool_mpmc_free(chry_blockpool_mpmc_t *mp, void *addr)
+{
+    uint32_t idx = chry_blockpool_calc_index((uintptr_t)addr - (uintptr_t)(mp->pool), mp->block_size, mp->block_shift, mp->block_inv, mp->block_cnt);
+
+    /*!< check is addr is our block */
+    if (idx >= mp->block_cnt) {
+        return -1;
+    }
+
+    /*!< cell ring hold every block, full means double free */
+    if (util_enqueue(mp, idx)) {
+        return -3;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        free one block to mpmc blockpool without check,
+*               lock-free, any thread can call
+* 
+* @param[in]    mp          mpmc blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+*****************************************************************************/
+void chry_blockpool_mpmc_free_fast(chry_blockpool_mpmc_t *mp, void *addr)
+{
+    util_enqueue(mp, ((uint32_t)((uintptr_t)addr - (uintptr_t)(mp->pool)) >> mp->block_shift) * mp->block_inv);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_MPMC_H
+#define CHRY_BLOCKPOOL_MPMC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+typedef struct {
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) seq; /*!< Define the cell sequence number. */
+    uint32_t idx;                        /*!< Define the free block index.     */
+} chry_blockpool_cell_t;
+
+typedef struct {
+    uint32_t block_cnt;                  /*!< Define the block count.              */
+    uint32_t block_size;                 /*!< Define the aligned block size.       */
+    uint32_t block_shift;                /*!< Define the block size power of 2.    */
+    uint32_t block_inv;                  /*!< Define the block size odd inverse.   */
+    uint32_t mask;                       /*!< Define the cell count mask.          */
+    void *pool;                          /*!< Define the memory pointer.           */
+    chry_blockpool_cell_t *cells;        /*!< Define the free block cell ring.     */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) in;  /*!< Define the free side enqueue pointer. */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) out; /*!< Define the alloc side dequeue pointer. */
+} chry_blockpool_mpmc_t;
+
+extern int chry_blockpool_mpmc_init(chry_blockpool_mpmc_t *mp, uint32_t align, uint32_t block_size, void *pool, uint32_t size);
+extern void chry_blockpool_mpmc_reset(chry_blockpool_mpmc_t *mp);
+
+extern uint32_t chry_blockpool_mpmc_get_size(chry_blockpool_mpmc_t *mp);
+extern uint32_t chry_blockpool_mpmc_get_free(chry_blockpool_mpmc_t *mp);
+
+extern int chry_blockpool_mpmc_alloc(chry_blockpool_mpmc_t *mp, void **addr);
+extern uint32_t chry_blockpool_mpmc_alloc_burst(chry_blockpool_mpmc_t *mp, void **addrs, uint32_t n);
+extern int chry_blockpool_mpmc_free(chry_blockpool_mpmc_t *mp, void *addr);
+extern void chry_blockpool_mpmc_free_fast(chry_blockpool_mpmc_t *mp, void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "chry_blockpool_numa.h"
+
+/*!< linux/mempolicy.h value, no libnuma needed */
+#define UTIL_MPOL_BIND 2
+
+/*!< kernel MAX_NUMNODES upper limit, larger node never bound */
+#define UTIL_NODE_LIMIT 1024
+
+/*!< calling thread last cpu and its kernel node, looked up again only after migrate */
+static _Thread_local int util_cpu = -1;
+static _Thread_local unsigned int util_node = 0;
+
+static uint32_t util_parse_list(const char *list, uint32_t *ids, uint32_t max)
+{
+    unsigned long first;
+    unsigned long last;
+    uint32_t cnt = 0;
+    char *end;
+
+    /*!< kernel cpulist format, "0", "0-1", "0,2", "0-1,4", stop at first bad item */
+    while (cnt < max) {
+        first = strtoul(list, &end, 10);
+
+        if (end == list) {
+            break;
+        }
+
+        last = first;
+
+        if ('-' == *end) {
+            list = end + 1;
+            last = strtoul(list, &end, 10);
+
+            if ((end == list) || (last < first)) {
+                break;
+            }
+        }
+
+        for (; (first <= last) && (cnt < max); first++) {
+            ids[cnt++] = (uint32_t)first;
+        }
+
+        if (',' != *end) {
+            break;
+        }
+
+        list = end + 1;
+    }
+
+    return cnt;
+}
+
+static uint32_t util_node_list(uint32_t *ids)
+{
+    FILE *fp = fopen("/sys/devices/system/node/online", "r");
+    char line[256];
+    uint32_t cnt = 0;
+
+    if (NULL != fp) {
+        if (NULL != fgets(line, sizeof(line), fp)) {
+            cnt = util_parse_list(line, ids, CHRY_BLOCKPOOL_NUMA_MAX);
+        }
+
+        fclose(fp);
+    }
+
+    /*!< no sysfs node means one node */
+    if (0 == cnt) {
+        ids[cnt++] = 0;
+    }
+
+    return cnt;
+}
+
+static void util_bind(void *addr, size_t size, uint32_t node)
+{
+#ifdef SYS_mbind
+    unsigned long mask[UTIL_NODE_LIMIT / (sizeof(unsigned long) * 8)] = { 0 };
+
+    if (node >= UTIL_NODE_LIMIT) {
+        return;
+    }
+
+    mask[node / (sizeof(unsigned long) * 8)] = 0x1UL << (node % (sizeof(unsigned long) * 8));
+
+    /*!< best effort, refused bind leave default policy */
+    syscall(SYS_mbind, addr, size, UTIL_MPOL_BIND, mask, (unsigned long)UTIL_NODE_LIMIT + 1, 0);
+#else
+    (void)addr;
+    (void)size;
+    (void)node;
+#endif
+}
+
+/*****************************************************************************
+* @brief        init numa blockpool set, one lock-free blockpool per node,
+*               each node memory bound to its node, single node degrade to one pool,
+*               node stride round up to power of 2, tail only reserve address space
+* 
+* @param[in]    np          numa blockpool set instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    node_size   memory size per node in byte
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_numa_init(chry_blockpool_numa_t *np, uint32_t align, uint32_t block_size, uint32_t node_size)
+{
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    np->node_cnt = util_node_list(np->node_id);
+
+    /*!< owner node by shift on free, untouched tail never commit memory */
+    for (np->stride_shift = 0; ((size_t)0x1 << np->stride_shift) < (size_t)node_size || ((size_t)0x1 << np->stride_shift) < page; np->stride_shift++) {
+    }
+
+    np->stride = (size_t)0x1 << np->stride_shift;
+    np->base = mmap(NULL, np->stride * np->node_cnt, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (MAP_FAILED == np->base) {
+        return -1;
+    }
+
+    /*!< bind before first touch, init write metadata on its node */
+    for (uint32_t i = 0; i < np->node_cnt; i++) {
+        void *pool = (uint8_t *)(np->base) + i * np->stride;
+
+        if (np->node_cnt > 1) {
+            util_bind(pool, np->stride, np->node_id[i]);
+        }
+
+        if (chry_blockpool_mpmc_init(&(np->pools[i]), align, block_size, pool, node_size)) {
+            munmap(np->base, np->stride * np->node_cnt);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        deinit numa blockpool set, release mapping
+* 
+* @param[in]    np          numa blockpool set instance
+* 
+*****************************************************************************/
+void chry_blockpool_numa_deinit(chry_blockpool_numa_t *np)
+{
+    munmap(np->base, np->stride * np->node_cnt);
+}
+
+/*****************************************************************************
+* @brief        get node of calling thread, sched_getcpu each call,
+*               kernel node from getcpu only when thread moved cpu
+* 
+* @param[in]    np          numa blockpool set instance
+* 
+* @retval uint32_t          node index below node count
+*****************************************************************************/
+uint32_t chry_blockpool_numa_get_node(chry_blockpool_numa_t *np)
+{
+    int cpu;
+
+    if (np->node_cnt < 2) {
+        return 0;
+    }
+
+    /*!< sched_getcpu read rseq area or vdso, no syscall on the alloc path */
+    cpu = sched_getcpu();
+
+    if (cpu != util_cpu) {
+        util_cpu = cpu;
+        util_node = 0;
+#ifdef SYS_getcpu
+        if (syscall(SYS_getcpu, NULL, &util_node, NULL)) {
+            util_node = 0;
+        }
+#endif
+    }
+
+    /*!< kernel node id may be sparse, pool index by lookup */
+    for (uint32_t i = 0; i < np->node_cnt; i++) {
+        if (np->node_id[i] == util_node) {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        alloc one block from caller node, other node when local empty,
+*               any thread, not need lock
+* 
+* @param[in]    np          numa blockpool set instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_numa_alloc(chry_blockpool_numa_t *np, void **addr)
+{
+    uint32_t node = chry_blockpool_numa_get_node(np);
+
+    /*!< remote memory before failure */
+    for (uint32_t i = 0; i < np->node_cnt; i++, node = (node + 1 == np->node_cnt) ? 0 : node + 1) {
+        if (0 == chry_blockpool_mpmc_alloc(&(np->pools[node]), addr)) {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*****************************************************************************
+* @brief        free one block to its owner node, node found by address,
+*               any thread, not need lock
+* 
+* @param[in]    np          numa blockpool set instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_blockpool_numa_free(chry_blockpool_numa_t *np, void *addr)
+{
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(np->base);
+
+    /*!< addr below base wrap to large offset */
+    if (address >= np->stride * np->node_cnt) {
+        return -1;
+    }
+
+    return chry_blockpool_mpmc_free(&(np->pools[address >> np->stride_shift]), addr);
+}
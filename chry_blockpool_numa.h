@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_NUMA_H
+#define CHRY_BLOCKPOOL_NUMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool_mpmc.h"
+
+#ifndef CHRY_BLOCKPOOL_NUMA_MAX
+#define CHRY_BLOCKPOOL_NUMA_MAX 8
+#endif
+
+typedef struct {
+    chry_blockpool_mpmc_t pools[CHRY_BLOCKPOOL_NUMA_MAX]; /*!< Define the per node blockpool.  */
+    uint32_t node_id[CHRY_BLOCKPOOL_NUMA_MAX];             /*!< Define the kernel node per pool. */
+    uint32_t node_cnt;                                     /*!< Define the node count.          */
+    uint32_t stride_shift;                                 /*!< Define the stride power of 2.   */
+    size_t stride;                                         /*!< Define the per node memory size. */
+    void *base;                                            /*!< Define the mapping address.     */
+} chry_blockpool_numa_t;
+
+extern int chry_blockpool_numa_init(chry_blockpool_numa_t *np, uint32_t align, uint32_t block_size, uint32_t node_size);
+extern void chry_blockpool_numa_deinit(chry_blockpool_numa_t *np);
+
+extern uint32_t chry_blockpool_numa_get_node(chry_blockpool_numa_t *np);
+
+extern int chry_blockpool_numa_alloc(chry_blockpool_numa_t *np, void **addr);
+extern int chry_blockpool_numa_free(chry_blockpool_numa_t *np, void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
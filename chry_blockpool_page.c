@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "chry_blockpool_page.h"
+
+/*!< MADV_DONTNEED drop RSS at once, MADV_FREE let kernel reclaim under pressure */
+#ifndef CHRY_BLOCKPOOL_PAGE_ADVICE
+#define CHRY_BLOCKPOOL_PAGE_ADVICE MADV_DONTNEED
+#endif
+
+#define UTIL_NIL    UINT32_MAX
+#define UTIL_NIL16  UINT16_MAX
+
+static uint32_t util_map_words(uint32_t block_cnt)
+{
+    return (block_cnt + 1 + 31) / 32;
+}
+
+static uint32_t util_meta_size(uint32_t page_cnt, uint32_t block_cnt)
+{
+    /*!< page state, free count bucket and its bitmap, then one used bit per block */
+    return page_cnt * sizeof(chry_blockpool_page_meta_t) + (block_cnt + 1 + util_map_words(block_cnt)) * sizeof(uint32_t) +
+           page_cnt * ((block_cnt + 31) / 32) * sizeof(uint32_t);
+}
+
+static void util_list_add(chry_blockpool_page_t *pp, uint32_t *head, uint32_t page)
+{
+    pp->meta[page].prev = UTIL_NIL;
+    pp->meta[page].next = *head;
+
+    if (UTIL_NIL != *head) {
+        pp->meta[*head].prev = page;
+    }
+
+    *head = page;
+}
+
+static void util_list_del(chry_blockpool_page_t *pp, uint32_t *head, uint32_t page)
+{
+    chry_blockpool_page_meta_t *meta = &(pp->meta[page]);
+
+    if (UTIL_NIL != meta->prev) {
+        pp->meta[meta->prev].next = meta->next;
+    } else {
+        *head = meta->next;
+    }
+
+    if (UTIL_NIL != meta->next) {
+        pp->meta[meta->next].prev = meta->prev;
+    }
+}
+
+static void util_bucket_add(chry_blockpool_page_t *pp, uint32_t page)
+{
+    uint32_t cnt = pp->meta[page].free_cnt;
+
+    util_list_add(pp, &(pp->bucket[cnt]), page);
+    pp->bucket_map[cnt / 32] |= 0x1UL << (cnt % 32);
+}
+
+static void util_bucket_del(chry_blockpool_page_t *pp, uint32_t page)
+{
+    uint32_t cnt = pp->meta[page].free_cnt;
+
+    util_list_del(pp, &(pp->bucket[cnt]), page);
+
+    if (UTIL_NIL == pp->bucket[cnt]) {
+        pp->bucket_map[cnt / 32] &= ~(0x1UL << (cnt % 32));
+    }
+}
+
+static uint32_t util_bucket_first(chry_blockpool_page_t *pp)
+{
+    /*!< lowest free count first, most occupied page */
+    for (uint32_t i = 0; i < util_map_words(pp->block_cnt); i++) {
+        if (pp->bucket_map[i]) {
+            return pp->bucket[i * 32 + __builtin_ctz(pp->bucket_map[i])];
+        }
+    }
+
+    return UTIL_NIL;
+}
+
+static void util_release(chry_blockpool_page_t *pp, uint32_t page)
+{
+    util_list_del(pp, &(pp->empty), page);
+    pp->empty_cnt--;
+
+    /*!< page content dropped, page state restart from bump */
+    madvise(pp->data + ((size_t)page << pp->page_shift), (size_t)1 << pp->page_shift, CHRY_BLOCKPOOL_PAGE_ADVICE);
+
+    pp->meta[page].released = 1;
+    util_list_add(pp, &(pp->released), page);
+    pp->released_cnt++;
+}
+
+/*****************************************************************************
+* @brief        init page occupancy blockpool, per page state placed first,
+*               block never cross page, alloc prefer most occupied page,
+*               page become empty given back to kernel beyond retain count
+* 
+* @param[in]    pp          page blockpool instance
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte, not above page size
+* @param[in]    pool        memory pool address, page aligned anonymous mapping
+* @param[in]    size        memory size in byte
+* @param[in]    retain      resident empty page kept for reuse
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_page_init(chry_blockpool_page_t *pp, uint32_t align, uint32_t block_size, void *pool, uint32_t size, uint32_t retain)
+{
+    uint32_t page = (uint32_t)sysconf(_SC_PAGESIZE);
+    uint32_t total = size / page;
+    uint32_t cnt;
+
+    if ((0 == block_size) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096) || ((uintptr_t)pool & (page - 1))) {
+        return -1;
+    }
+
+    block_size = (block_size + (0x1UL << align) - 1) & ~((0x1UL << align) - 1);
+
+    /*!< in page index is 16 bit, freed link hold in block first 2 byte */
+    if ((block_size > page) || (page / block_size >= UTIL_NIL16)) {
+        return -1;
+    }
+
+    pp->block_size = block_size;
+    pp->block_cnt = page / block_size;
+    pp->map_words = (pp->block_cnt + 31) / 32;
+    chry_blockpool_calc_inverse(block_size, &(pp->block_shift), &(pp->block_inv));
+    pp->page_shift = __builtin_ctz(page);
+
+    /*!< state page first, settle in few step */
+    for (cnt = total; cnt && (util_meta_size(cnt, pp->block_cnt) > (total - cnt) * page); cnt--) {
+    }
+
+    if (0 == cnt) {
+        return -1;
+    }
+
+    pp->page_cnt = cnt;
+    pp->meta = (chry_blockpool_page_meta_t *)pool;
+    pp->bucket = (uint32_t *)(pp->meta + cnt);
+    pp->bucket_map = pp->bucket + pp->block_cnt + 1;
+    pp->block_map = pp->bucket_map + util_map_words(pp->block_cnt);
+    pp->data = (uint8_t *)pool + (size_t)(total - cnt) * page;
+
+    memset(pp->bucket, 0xff, (pp->block_cnt + 1) * sizeof(uint32_t));
+    memset(pp->bucket_map, 0, util_map_words(pp->block_cnt) * sizeof(uint32_t));
+    memset(pp->block_map, 0, (size_t)cnt * pp->map_words * sizeof(uint32_t));
+
+    pp->empty = UTIL_NIL;
+    pp->empty_cnt = 0;
+    pp->released = UTIL_NIL;
+    pp->released_cnt = 0;
+    pp->retain = retain;
+    pp->used = 0;
+
+    /*!< never touched page count as released, low address first */
+    for (uint32_t i = cnt; i > 0; i--) {
+        pp->meta[i - 1].free_cnt = (uint16_t)pp->block_cnt;
+        pp->meta[i - 1].bump = 0;
+        pp->meta[i - 1].free_head = UTIL_NIL16;
+        pp->meta[i - 1].released = 1;
+        util_list_add(pp, &(pp->released), i - 1);
+    }
+
+    pp->released_cnt = cnt;
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        get used size in block count
+* 
+* @param[in]    pp          page blockpool instance
+* 
+* @retval uint32_t          used size in block count
+*****************************************************************************/
+uint32_t chry_blockpool_page_get_used(chry_blockpool_page_t *pp)
+{
+    return pp->used;
+}
+
+/*****************************************************************************
+* @brief        get block page not given back to kernel
+* 
+* @param[in]    pp          page blockpool instance
+* 
+* @retval uint32_t          resident page count
+*****************************************************************************/
+uint32_t chry_blockpool_page_get_resident(chry_blockpool_page_t *pp)
+{
+    return pp->page_cnt - pp->released_cnt;
+}
+
+/*****************************************************************************
+* @brief        alloc one block from the most occupied page with free block,
+*               then resident empty page, then released page,
+*               should be add lock in mutithread
+* 
+* @param[in]    pp          page blockpool instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_page_alloc(chry_blockpool_page_t *pp, void **addr)
+{
+    uint32_t page = util_bucket_first(pp);
+    chry_blockpool_page_meta_t *meta;
+    uint8_t *block;
+    uint32_t idx;
+
+    if (UTIL_NIL != page) {
+        util_bucket_del(pp, page);
+    } else if (UTIL_NIL != (page = pp->empty)) {
+        util_list_del(pp, &(pp->empty), page);
+        pp->empty_cnt--;
+    } else if (UTIL_NIL != (page = pp->released)) {
+        util_list_del(pp, &(pp->released), page);
+        pp->released_cnt--;
+        pp->meta[page].released = 0;
+    } else {
+        return -1;
+    }
+
+    meta = &(pp->meta[page]);
+
+    /*!< freed block first, else never used block */
+    if (UTIL_NIL16 != meta->free_head) {
+        idx = meta->free_head;
+        block = pp->data + ((size_t)page << pp->page_shift) + idx * pp->block_size;
+        memcpy(&(meta->free_head), block, sizeof(uint16_t));
+    } else {
+        idx = meta->bump++;
+        block = pp->data + ((size_t)page << pp->page_shift) + idx * pp->block_size;
+    }
+
+    pp->block_map[page * pp->map_words + idx / 32] |= 0x1UL << (idx % 32);
+
+    /*!< full page in no list */
+    if (--meta->free_cnt) {
+        util_bucket_add(pp, page);
+    }
+
+    pp->used++;
+    *addr = block;
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        free one block to its page, page become empty given back
+*               to kernel once resident empty page beyond retain count,
+*               should be add lock in mutithread
+* 
+* @param[in]    pp          page blockpool instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr
+* @retval int               -2:Already free
+*****************************************************************************/
+int chry_blockpool_page_free(chry_blockpool_page_t *pp, void *addr)
+{
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(pp->data);
+    chry_blockpool_page_meta_t *meta;
+    uint32_t *word;
+    uint32_t page;
+    uint32_t offset;
+    uint32_t idx;
+
+    /*!< addr below pool wrap to large offset */
+    if (address >= ((uintptr_t)pp->page_cnt << pp->page_shift)) {
+        return -1;
+    }
+
+    page = (uint32_t)(address >> pp->page_shift);
+    offset = (uint32_t)(address & (((uintptr_t)1 << pp->page_shift) - 1));
+    meta = &(pp->meta[page]);
+
+    idx = chry_blockpool_calc_index(offset, pp->block_size, pp->block_shift, pp->block_inv, pp->block_cnt);
+
+    if (idx >= pp->block_cnt) {
+        return -1;
+    }
+
+    /*!< never used or freed block has used bit clear */
+    word = &(pp->block_map[page * pp->map_words + idx / 32]);
+
+    if (!(*word & (0x1UL << (idx % 32)))) {
+        return -2;
+    }
+
+    *word &= ~(0x1UL << (idx % 32));
+
+    if (meta->free_cnt) {
+        util_bucket_del(pp, page);
+    }
+
+    memcpy(addr, &(meta->free_head), sizeof(uint16_t));
+    meta->free_head = (uint16_t)idx;
+    meta->free_cnt++;
+    pp->used--;
+
+    if (meta->free_cnt != pp->block_cnt) {
+        util_bucket_add(pp, page);
+        return 0;
+    }
+
+    /*!< empty page restart from bump, no freed link needed */
+    meta->free_head = UTIL_NIL16;
+    meta->bump = 0;
+    util_list_add(pp, &(pp->empty), page);
+    pp->empty_cnt++;
+
+    if (pp->empty_cnt > pp->retain) {
+        util_release(pp, page);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        give every resident empty page back to kernel,
+*               should be add lock in mutithread
+* 
+* @param[in]    pp          page blockpool instance
+* 
+* @retval uint32_t          released page count
+*****************************************************************************/
+uint32_t chry_blockpool_page_trim(chry_blockpool_page_t *pp)
+{
+    uint32_t cnt = 0;
+
+    while (UTIL_NIL != pp->empty) {
+        util_release(pp, pp->empty);
+        cnt++;
+    }
+
+    return cnt;
+}
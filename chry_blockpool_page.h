@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_PAGE_H
+#define CHRY_BLOCKPOOL_PAGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+typedef struct {
+    uint32_t prev;      /*!< Define the previous page in list.   */
+    uint32_t next;      /*!< Define the next page in list.       */
+    uint16_t free_cnt;  /*!< Define the free block count.        */
+    uint16_t bump;      /*!< Define the first never used block.  */
+    uint16_t free_head; /*!< Define the first freed block.       */
+    uint16_t released;  /*!< Define the page given back to kernel. */
+} chry_blockpool_page_meta_t;
+
+typedef struct {
+    uint8_t *data;                    /*!< Define the first block page.           */
+    chry_blockpool_page_meta_t *meta; /*!< Define the per page state.             */
+    uint32_t *bucket;                 /*!< Define the page list per free count.   */
+    uint32_t *bucket_map;             /*!< Define the non empty bucket bitmap.    */
+    uint32_t *block_map;              /*!< Define the per page used block bitmap. */
+    uint32_t map_words;               /*!< Define the used bitmap word per page.  */
+    uint32_t page_cnt;                /*!< Define the block page count.           */
+    uint32_t page_shift;              /*!< Define the page size power of 2.       */
+    uint32_t block_size;              /*!< Define the aligned block size.         */
+    uint32_t block_shift;             /*!< Define the block size power of 2.      */
+    uint32_t block_inv;               /*!< Define the block size odd inverse.     */
+    uint32_t block_cnt;               /*!< Define the block count per page.       */
+    uint32_t empty;                   /*!< Define the resident empty page list.   */
+    uint32_t empty_cnt;               /*!< Define the resident empty page count.  */
+    uint32_t released;                /*!< Define the released page list.         */
+    uint32_t released_cnt;            /*!< Define the released page count.        */
+    uint32_t retain;                  /*!< Define the resident empty page keep.   */
+    uint32_t used;                    /*!< Define the used block count.           */
+} chry_blockpool_page_t;
+
+extern int chry_blockpool_page_init(chry_blockpool_page_t *pp, uint32_t align, uint32_t block_size, void *pool, uint32_t size, uint32_t retain);
+
+extern uint32_t chry_blockpool_page_get_used(chry_blockpool_page_t *pp);
+extern uint32_t chry_blockpool_page_get_resident(chry_blockpool_page_t *pp);
+
+extern int chry_blockpool_page_alloc(chry_blockpool_page_t *pp, void **addr);
+extern int chry_blockpool_page_free(chry_blockpool_page_t *pp, void *addr);
+extern uint32_t chry_blockpool_page_trim(chry_blockpool_page_t *pp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
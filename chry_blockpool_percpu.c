@@ -0,0 +1,499 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "chry_blockpool_percpu.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#if defined(__linux__) && defined(__x86_64__) && defined(__GNUC__) && defined(__has_include)
+#if __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define CHRY_BLOCKPOOL_RSEQ 1
+#endif
+#endif
+
+static inline chry_blockpool_percpu_stack_t *util_stack(chry_blockpool_percpu_t *pc, uint32_t cpu)
+{
+    return (chry_blockpool_percpu_stack_t *)(pc->stacks + cpu * pc->stride);
+}
+
+static void util_lock(atomic_flag *lock)
+{
+    while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire)) {
+    }
+}
+
+static void util_unlock(atomic_flag *lock)
+{
+    atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+static uint32_t util_pool_alloc(chry_blockpool_percpu_t *pc, void **addrs, uint32_t n)
+{
+    util_lock(&(pc->lock));
+    n = chry_blockpool_alloc_burst(pc->bp, addrs, n);
+    util_unlock(&(pc->lock));
+
+    return n;
+}
+
+static void util_pool_free(chry_blockpool_percpu_t *pc, void *const *addrs, uint32_t n)
+{
+    util_lock(&(pc->lock));
+    chry_blockpool_free_bulk(pc->bp, addrs, n);
+    util_unlock(&(pc->lock));
+}
+
+static uint32_t util_cpu(void)
+{
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+
+    return (cpu < 0) ? 0 : (uint32_t)cpu;
+#else
+    return 0;
+#endif
+}
+
+#ifdef CHRY_BLOCKPOOL_RSEQ
+static inline struct rseq *util_rseq(void)
+{
+    uintptr_t tp;
+
+    __asm__("movq %%fs:0, %0" : "=r"(tp));
+
+    return (struct rseq *)(tp + __rseq_offset);
+}
+
+static inline uint32_t util_rseq_cpu(struct rseq *rs)
+{
+    return *(volatile uint32_t *)&(rs->cpu_id_start);
+}
+
+static bool util_rseq_usable(void)
+{
+    /*!< registered by glibc 2.35 or later, unless disabled by tunable */
+    return (__rseq_size > 0) && ((int32_t)*(volatile uint32_t *)&(util_rseq()->cpu_id) >= 0);
+}
+
+/*!< 0:Success -1:Empty -2:Aborted or migrated */
+static inline int util_rseq_pop(struct rseq *rs, chry_blockpool_percpu_stack_t *stk, uint32_t cpu, void **addr)
+{
+    __asm__ __volatile__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"
+        ".quad 1f, (2f - 1f), 4f\n\t"
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %c[id](%[rs])\n\t"
+        "jnz %l[abort]\n\t"
+        "movq (%[stk]), %%rax\n\t"
+        "testq %%rax, %%rax\n\t"
+        "jz %l[empty]\n\t"
+        "movq %c[slots]-8(%[stk], %%rax, 8), %%rcx\n\t"
+        "movq %%rcx, (%[addr])\n\t"
+        "decq %%rax\n\t"
+        "movq %%rax, (%[stk])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [rs] "r"(rs), [stk] "r"(stk), [cpu] "r"(cpu), [addr] "r"(addr),
+          [cs] "i"(offsetof(struct rseq, rseq_cs)), [id] "i"(offsetof(struct rseq, cpu_id)),
+          [slots] "i"(offsetof(chry_blockpool_percpu_stack_t, slots))
+        : "memory", "cc", "rax", "rcx"
+        : abort, empty);
+
+    return 0;
+
+abort:
+    return -2;
+
+empty:
+    return -1;
+}
+
+/*!< 0:Success -1:Full -2:Aborted or migrated */
+static inline int util_rseq_push(struct rseq *rs, chry_blockpool_percpu_stack_t *stk, uint32_t cpu, uintptr_t depth, void *addr)
+{
+    __asm__ __volatile__ goto(
+        ".pushsection __rseq_cs, \"aw\"\n\t"
+        ".balign 32\n\t"
+        "3:\n\t"
+        ".long 0x0, 0x0\n\t"
+        ".quad 1f, (2f - 1f), 4f\n\t"
+        ".popsection\n\t"
+        "leaq 3b(%%rip), %%rax\n\t"
+        "movq %%rax, %c[cs](%[rs])\n\t"
+        "1:\n\t"
+        "cmpl %[cpu], %c[id](%[rs])\n\t"
+        "jnz %l[abort]\n\t"
+        "movq (%[stk]), %%rax\n\t"
+        "cmpq %[depth], %%rax\n\t"
+        "jae %l[full]\n\t"
+        "movq %[addr], %c[slots](%[stk], %%rax, 8)\n\t"
+        "incq %%rax\n\t"
+        "movq %%rax, (%[stk])\n\t"
+        "2:\n\t"
+        ".pushsection __rseq_failure, \"ax\"\n\t"
+        ".byte 0x0f, 0xb9, 0x3d\n\t"
+        ".long 0x53053053\n\t"
+        "4:\n\t"
+        "jmp %l[abort]\n\t"
+        ".popsection\n\t"
+        :
+        : [rs] "r"(rs), [stk] "r"(stk), [cpu] "r"(cpu), [depth] "r"(depth), [addr] "r"(addr),
+          [cs] "i"(offsetof(struct rseq, rseq_cs)), [id] "i"(offsetof(struct rseq, cpu_id)),
+          [slots] "i"(offsetof(chry_blockpool_percpu_stack_t, slots))
+        : "memory", "cc", "rax"
+        : abort, full);
+
+    return 0;
+
+abort:
+    return -2;
+
+full:
+    return -1;
+}
+
+static int util_rseq_alloc(chry_blockpool_percpu_t *pc, void **addr)
+{
+    struct rseq *rs = util_rseq();
+    void *batch[CHRY_BLOCKPOOL_PERCPU_BATCH];
+    uint32_t cpu;
+    uint32_t n;
+    uint32_t i;
+    int ret;
+
+    while (1) {
+        cpu = util_rseq_cpu(rs);
+
+        if (cpu >= pc->cpu_cnt) {
+            return util_pool_alloc(pc, addr, 1) ? 0 : -1;
+        }
+
+        ret = util_rseq_pop(rs, util_stack(pc, cpu), cpu, addr);
+
+        if (-2 != ret) {
+            break;
+        }
+    }
+
+    if (0 == ret) {
+        return 0;
+    }
+
+    /*!< stack empty, keep one block and push the rest of a batch */
+    n = util_pool_alloc(pc, batch, pc->batch);
+
+    if (0 == n) {
+        return -1;
+    }
+
+    *addr = batch[--n];
+
+    for (i = 0; i < n;) {
+        cpu = util_rseq_cpu(rs);
+
+        if (cpu >= pc->cpu_cnt) {
+            break;
+        }
+
+        ret = util_rseq_push(rs, util_stack(pc, cpu), cpu, pc->depth, batch[i]);
+
+        if (-1 == ret) {
+            break;
+        }
+
+        i += (0 == ret);
+    }
+
+    if (i < n) {
+        util_pool_free(pc, batch + i, n - i);
+    }
+
+    return 0;
+}
+
+static void util_rseq_free(chry_blockpool_percpu_t *pc, void *addr)
+{
+    struct rseq *rs = util_rseq();
+    void *batch[CHRY_BLOCKPOOL_PERCPU_BATCH + 1];
+    uint32_t cpu;
+    uint32_t n;
+    int ret;
+
+    while (1) {
+        cpu = util_rseq_cpu(rs);
+
+        if (cpu >= pc->cpu_cnt) {
+            util_pool_free(pc, &addr, 1);
+            return;
+        }
+
+        ret = util_rseq_push(rs, util_stack(pc, cpu), cpu, pc->depth, addr);
+
+        if (0 == ret) {
+            return;
+        } else if (-1 == ret) {
+            break;
+        }
+    }
+
+    /*!< stack full, drain a batch together with this block */
+    for (n = 0; n < pc->batch;) {
+        ret = util_rseq_pop(rs, util_stack(pc, cpu), cpu, &(batch[n]));
+
+        if (-1 == ret) {
+            break;
+        } else if (-2 == ret) {
+            cpu = util_rseq_cpu(rs);
+
+            if (cpu >= pc->cpu_cnt) {
+                break;
+            }
+        } else {
+            n++;
+        }
+    }
+
+    batch[n++] = addr;
+    util_pool_free(pc, batch, n);
+}
+
+static uint32_t util_rseq_flush(chry_blockpool_percpu_t *pc, uint32_t cpu)
+{
+    struct rseq *rs = util_rseq();
+    void *batch[CHRY_BLOCKPOOL_PERCPU_BATCH];
+    cpu_set_t old;
+    cpu_set_t set;
+    uint32_t cnt = 0;
+    uint32_t n;
+    int ret;
+
+    /*!< stack only change on its own cpu, run there and pop like alloc */
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    if (sched_getaffinity(0, sizeof(old), &old) || sched_setaffinity(0, sizeof(set), &set)) {
+        return 0;
+    }
+
+    do {
+        for (n = 0; n < pc->batch;) {
+            /*!< abort until affinity moved us there */
+            ret = util_rseq_pop(rs, util_stack(pc, cpu), cpu, &(batch[n]));
+
+            if (-1 == ret) {
+                break;
+            }
+
+            n += (0 == ret);
+        }
+
+        util_pool_free(pc, batch, n);
+        cnt += n;
+    } while (n == pc->batch);
+
+    sched_setaffinity(0, sizeof(old), &old);
+
+    return cnt;
+}
+#endif
+
+/*****************************************************************************
+* @brief        init per cpu stacks over a blockpool,
+*               uses rseq when the thread library registered it,
+*               otherwise falls back to per cpu spin locks
+* 
+* @param[in]    pc          percpu instance
+* @param[in]    bp          backing blockpool, only touched under percpu lock
+* @param[in]    cpu_cnt     cpu count, cpu above take the backing pool directly
+* @param[in]    depth       block count per cpu stack
+* @param[in]    mem         stack memory, 64 byte aligned
+* @param[in]    size        stack memory size in byte,
+*                           CHRY_BLOCKPOOL_PERCPU_SIZE(cpu_cnt, depth)
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_percpu_init(chry_blockpool_percpu_t *pc, chry_blockpool_t *bp, uint32_t cpu_cnt, uint32_t depth, void *mem, uint32_t size)
+{
+    if ((0 == cpu_cnt) || (0 == depth) || (size < CHRY_BLOCKPOOL_PERCPU_SIZE(cpu_cnt, depth))) {
+        return -1;
+    }
+
+    pc->bp = bp;
+    pc->cpu_cnt = cpu_cnt;
+    pc->depth = depth;
+    pc->batch = (depth + 1) / 2;
+    pc->stride = CHRY_BLOCKPOOL_PERCPU_STRIDE(depth);
+    pc->stacks = mem;
+    atomic_flag_clear(&(pc->lock));
+
+    if (pc->batch > CHRY_BLOCKPOOL_PERCPU_BATCH) {
+        pc->batch = CHRY_BLOCKPOOL_PERCPU_BATCH;
+    }
+
+    for (uint32_t i = 0; i < cpu_cnt; i++) {
+        util_stack(pc, i)->top = 0;
+        atomic_flag_clear(&(util_stack(pc, i)->lock));
+    }
+
+#ifdef CHRY_BLOCKPOOL_RSEQ
+    pc->rseq = util_rseq_usable();
+#else
+    pc->rseq = false;
+#endif
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        alloc one block from current cpu stack,
+*               refills a batch from blockpool when empty
+* 
+* @param[in]    pc          percpu instance
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem
+*****************************************************************************/
+int chry_blockpool_percpu_alloc(chry_blockpool_percpu_t *pc, void **addr)
+{
+    chry_blockpool_percpu_stack_t *stk;
+
+#ifdef CHRY_BLOCKPOOL_RSEQ
+    if (pc->rseq) {
+        return util_rseq_alloc(pc, addr);
+    }
+#endif
+
+    stk = util_stack(pc, util_cpu() % pc->cpu_cnt);
+
+    util_lock(&(stk->lock));
+
+    if (0 == stk->top) {
+        stk->top = util_pool_alloc(pc, stk->slots, pc->batch);
+    }
+
+    if (0 == stk->top) {
+        util_unlock(&(stk->lock));
+        return -1;
+    }
+
+    *addr = stk->slots[--stk->top];
+
+    util_unlock(&(stk->lock));
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        free one block to current cpu stack without check,
+*               drains a batch to blockpool when full
+* 
+* @param[in]    pc          percpu instance
+* @param[in]    addr        pointer to free block
+* 
+*****************************************************************************/
+void chry_blockpool_percpu_free(chry_blockpool_percpu_t *pc, void *addr)
+{
+    chry_blockpool_percpu_stack_t *stk;
+
+#ifdef CHRY_BLOCKPOOL_RSEQ
+    if (pc->rseq) {
+        util_rseq_free(pc, addr);
+        return;
+    }
+#endif
+
+    stk = util_stack(pc, util_cpu() % pc->cpu_cnt);
+
+    util_lock(&(stk->lock));
+
+    if (stk->top == pc->depth) {
+        stk->top -= pc->batch;
+        util_pool_free(pc, stk->slots + stk->top, pc->batch);
+    }
+
+    stk->slots[stk->top++] = addr;
+
+    util_unlock(&(stk->lock));
+}
+
+/*****************************************************************************
+* @brief        return every block cached on one cpu stack to blockpool,
+*               rseq path pins the calling thread to that cpu for the flush
+*               and puts its own affinity mask back after, so the caller
+*               must not change its affinity meanwhile,
+*               fallback path takes the cpu stack lock
+* 
+* @param[in]    pc          percpu instance
+* @param[in]    cpu         cpu stack index, below cpu count
+* 
+* @retval uint32_t          returned block count, 0 when cpu can not be run on
+*****************************************************************************/
+uint32_t chry_blockpool_percpu_flush(chry_blockpool_percpu_t *pc, uint32_t cpu)
+{
+    chry_blockpool_percpu_stack_t *stk;
+    uint32_t cnt;
+
+    if (cpu >= pc->cpu_cnt) {
+        return 0;
+    }
+
+#ifdef CHRY_BLOCKPOOL_RSEQ
+    if (pc->rseq) {
+        return util_rseq_flush(pc, cpu);
+    }
+#endif
+
+    stk = util_stack(pc, cpu);
+
+    util_lock(&(stk->lock));
+
+    cnt = (uint32_t)stk->top;
+    stk->top = 0;
+    util_pool_free(pc, stk->slots, cnt);
+
+    util_unlock(&(stk->lock));
+
+    return cnt;
+}
+
+/*****************************************************************************
+* @brief        return every cpu stack to blockpool, such as before trim
+*               or teardown, blocks freed meanwhile may be cached again,
+*               rseq path moves the caller over every cpu like flush
+* 
+* @param[in]    pc          percpu instance
+* 
+* @retval uint32_t          returned block count
+*****************************************************************************/
+uint32_t chry_blockpool_percpu_drain(chry_blockpool_percpu_t *pc)
+{
+    uint32_t cnt = 0;
+
+    for (uint32_t i = 0; i < pc->cpu_cnt; i++) {
+        cnt += chry_blockpool_percpu_flush(pc, i);
+    }
+
+    return cnt;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_PERCPU_H
+#define CHRY_BLOCKPOOL_PERCPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+#define CHRY_BLOCKPOOL_PERCPU_BATCH 32
+
+typedef struct {
+    uintptr_t top;                   /*!< Define the block count in stack.    */
+    CHRY_BLOCKPOOL_ATOMIC_FLAG lock; /*!< Define the fallback path lock.      */
+    void *slots[];                   /*!< Define the block pointer stack.     */
+} chry_blockpool_percpu_stack_t;
+
+typedef struct {
+    chry_blockpool_t *bp;            /*!< Define the backing blockpool.      */
+    uint32_t cpu_cnt;                /*!< Define the per cpu stack count.    */
+    uint32_t depth;                  /*!< Define the per cpu stack depth.    */
+    uint32_t batch;                  /*!< Define the refill and drain count. */
+    uint32_t stride;                 /*!< Define the per cpu stack stride.   */
+    bool rseq;                       /*!< Define the rseq fast path in use.  */
+    CHRY_BLOCKPOOL_ATOMIC_FLAG lock; /*!< Define the backing blockpool lock. */
+    uint8_t *stacks;                 /*!< Define the per cpu stack memory.   */
+} chry_blockpool_percpu_t;
+
+#define CHRY_BLOCKPOOL_PERCPU_STRIDE(depth) ((sizeof(chry_blockpool_percpu_stack_t) + (depth) * sizeof(void *) + 63) & ~(size_t)63)
+#define CHRY_BLOCKPOOL_PERCPU_SIZE(cpu_cnt, depth) ((cpu_cnt) * CHRY_BLOCKPOOL_PERCPU_STRIDE(depth))
+
+extern int chry_blockpool_percpu_init(chry_blockpool_percpu_t *pc, chry_blockpool_t *bp, uint32_t cpu_cnt, uint32_t depth, void *mem, uint32_t size);
+
+extern int chry_blockpool_percpu_alloc(chry_blockpool_percpu_t *pc, void **addr);
+extern void chry_blockpool_percpu_free(chry_blockpool_percpu_t *pc, void *addr);
+
+extern uint32_t chry_blockpool_percpu_flush(chry_blockpool_percpu_t *pc, uint32_t cpu);
+extern uint32_t chry_blockpool_percpu_drain(chry_blockpool_percpu_t *pc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_blockpool_registry.h"
+
+#define REGISTRY_SPAN_SHIFT (CHRY_BLOCKPOOL_REGISTRY_SHIFT + CHRY_BLOCKPOOL_REGISTRY_SUB_BITS)
+#define REGISTRY_LEVELS     ((CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS - REGISTRY_SPAN_SHIFT) / CHRY_BLOCKPOOL_REGISTRY_BITS)
+#define REGISTRY_FANOUT     (0x1UL << CHRY_BLOCKPOOL_REGISTRY_BITS)
+#define REGISTRY_SUB        (0x1UL << CHRY_BLOCKPOOL_REGISTRY_SUB_BITS)
+#define REGISTRY_TAG        ((uintptr_t)0x1)
+
+#define REGISTRY_CHECK   0 /*!< conflict test, create nothing */
+#define REGISTRY_PREPARE 1 /*!< create radix path and sub leaf, mark nothing */
+#define REGISTRY_MARK    2 /*!< mark pool, every node already there */
+#define REGISTRY_UNMARK  3 /*!< clear slot still hold pool */
+
+#if (CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS - REGISTRY_SPAN_SHIFT) % CHRY_BLOCKPOOL_REGISTRY_BITS
+#error "registry address bits minus shift and sub bits must be a multiple of level bits"
+#endif
+
+#if REGISTRY_LEVELS < 2
+#error "registry need root and leaf level"
+#endif
+
+/*!< interior node slot point to next level, leaf entry cover one span of SUB regions,
+     span inside one pool hold the pool, span at a pool edge hold a tagged sub leaf,
+     sub leaf entry is a slot pair, [0] pool cover region start, [1] pool start inside region */
+static _Atomic(void *) registry_node[CHRY_BLOCKPOOL_REGISTRY_NODE_MAX][REGISTRY_FANOUT];
+static _Atomic(void *) registry_leaf[CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX][REGISTRY_FANOUT];
+static _Atomic(void *) registry_sub[CHRY_BLOCKPOOL_REGISTRY_SUB_MAX][2 * REGISTRY_SUB];
+static _Atomic uint32_t registry_node_cnt = 1;
+static _Atomic uint32_t registry_leaf_cnt = 0;
+static _Atomic uint32_t registry_sub_cnt = 0;
+static atomic_flag registry_lock = ATOMIC_FLAG_INIT;
+
+static void util_lock(void)
+{
+    while (atomic_flag_test_and_set_explicit(&registry_lock, memory_order_acquire)) {
+    }
+}
+
+static void util_unlock(void)
+{
+    atomic_flag_clear_explicit(&registry_lock, memory_order_release);
+}
+
+static bool util_out_range(uintptr_t address)
+{
+    /*!< two step shift, never shift by pointer width */
+    return ((address >> (CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS - 1)) >> 1) != 0;
+}
+
+static void *util_take(_Atomic uint32_t *cnt, uint32_t max, void *nodes, size_t size)
+{
+    uint32_t idx = atomic_fetch_add_explicit(cnt, 1, memory_order_relaxed);
+
+    if (idx >= max) {
+        atomic_fetch_sub_explicit(cnt, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    return (uint8_t *)nodes + idx * size;
+}
+
+static _Atomic(void *) *util_entry(uintptr_t span, bool create)
+{
+    _Atomic(void *) *node = registry_node[0];
+
+    for (uint32_t level = REGISTRY_LEVELS - 1; level > 0; level--) {
+        _Atomic(void *) *slot = &node[(span >> (level * CHRY_BLOCKPOOL_REGISTRY_BITS)) & (REGISTRY_FANOUT - 1)];
+        void *next = atomic_load_explicit(slot, memory_order_acquire);
+
+        if (NULL == next) {
+            /*!< create only under registry lock, last interior level point to leaf */
+            if (!create) {
+                return NULL;
+            }
+
+            if (1 == level) {
+                next = util_take(&registry_leaf_cnt, CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX, registry_leaf, sizeof(registry_leaf[0]));
+            } else {
+                next = util_take(&registry_node_cnt, CHRY_BLOCKPOOL_REGISTRY_NODE_MAX, registry_node, sizeof(registry_node[0]));
+            }
+
+            if (NULL == next) {
+                return NULL;
+            }
+
+            atomic_store_explicit(slot, next, memory_order_release);
+        }
+
+        node = (_Atomic(void *) *)next;
+    }
+
+    return &node[span & (REGISTRY_FANOUT - 1)];
+}
+
+static uintptr_t util_start(chry_blockpool_t *bp, uintptr_t region)
+{
+    /*!< lowest pool area start inside region, main block area or extra region */
+    uintptr_t start = UINTPTR_MAX;
+
+    if (((uintptr_t)(bp->pool) >> CHRY_BLOCKPOOL_REGISTRY_SHIFT) == region) {
+        start = (uintptr_t)(bp->pool);
+    }
+
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    for (uint32_t i = 0; i < bp->region_cnt; i++) {
+        uintptr_t pool = (uintptr_t)(bp->regions[i].pool);
+
+        if (((pool >> CHRY_BLOCKPOOL_REGISTRY_SHIFT) == region) && (pool < start)) {
+            start = pool;
+        }
+    }
+#endif
+
+    return start;
+}
+
+static int util_mark_sub(chry_blockpool_t *bp, uint32_t op, _Atomic(void *) *sub, uintptr_t span, uintptr_t pool, uintptr_t end)
+{
+    uintptr_t first = pool >> CHRY_BLOCKPOOL_REGISTRY_SHIFT;
+    uintptr_t last = (end - 1) >> CHRY_BLOCKPOOL_REGISTRY_SHIFT;
+    uintptr_t region = span << CHRY_BLOCKPOOL_REGISTRY_SUB_BITS;
+
+    for (uint32_t i = 0; i < REGISTRY_SUB; i++, region++) {
+        _Atomic(void *) *slot;
+        void *cur;
+
+        if ((region < first) || (region > last)) {
+            continue;
+        }
+
+        /*!< area start after region start take second slot */
+        slot = &sub[2 * i + ((region << CHRY_BLOCKPOOL_REGISTRY_SHIFT) < pool ? 1 : 0)];
+        cur = atomic_load_explicit(slot, memory_order_relaxed);
+
+        if (REGISTRY_CHECK == op) {
+            /*!< own slot already marked, register again after add region */
+            if ((NULL != cur) && (bp != cur)) {
+                return -1;
+            }
+        } else if (REGISTRY_MARK == op) {
+            atomic_store_explicit(slot, bp, memory_order_release);
+        } else if (bp == cur) {
+            atomic_store_explicit(slot, NULL, memory_order_release);
+        }
+    }
+
+    return 0;
+}
+
+static int util_mark_area(chry_blockpool_t *bp, uint32_t op, uintptr_t pool, uint32_t block_cnt)
+{
+    uintptr_t end = pool + (uintptr_t)block_cnt * bp->block_size;
+    uintptr_t last = (end - 1) >> REGISTRY_SPAN_SHIFT;
+
+    for (uintptr_t span = pool >> REGISTRY_SPAN_SHIFT; span <= last; span++) {
+        uintptr_t base = span << REGISTRY_SPAN_SHIFT;
+        _Atomic(void *) *entry = util_entry(span, REGISTRY_PREPARE == op);
+        _Atomic(void *) *sub;
+        void *cur;
+
+        if (NULL == entry) {
+            /*!< check and unmark see empty path, mark run after prepare built it */
+            if (REGISTRY_PREPARE == op) {
+                return -2;
+            }
+
+            continue;
+        }
+
+        cur = atomic_load_explicit(entry, memory_order_relaxed);
+
+        if ((uintptr_t)cur & REGISTRY_TAG) {
+            sub = (_Atomic(void *) *)((uintptr_t)cur & ~REGISTRY_TAG);
+
+            if ((REGISTRY_PREPARE != op) && util_mark_sub(bp, op, sub, span, pool, end)) {
+                return -1;
+            }
+        } else if (REGISTRY_CHECK == op) {
+            if ((NULL != cur) && (bp != cur)) {
+                return -1;
+            }
+        } else if (REGISTRY_UNMARK == op) {
+            if (bp == cur) {
+                atomic_store_explicit(entry, NULL, memory_order_release);
+            }
+        } else if ((NULL != cur) || ((base >= pool) && (end - base >= ((uintptr_t)0x1 << REGISTRY_SPAN_SHIFT)))) {
+            /*!< whole span inside pool, one entry, no sub leaf */
+            if (REGISTRY_MARK == op) {
+                atomic_store_explicit(entry, bp, memory_order_release);
+            }
+        } else if (REGISTRY_PREPARE == op) {
+            /*!< pool edge inside span, region slot pair decide */
+            sub = util_take(&registry_sub_cnt, CHRY_BLOCKPOOL_REGISTRY_SUB_MAX, registry_sub, sizeof(registry_sub[0]));
+
+            if (NULL == sub) {
+                return -2;
+            }
+
+            atomic_store_explicit(entry, (void *)((uintptr_t)sub | REGISTRY_TAG), memory_order_release);
+        }
+    }
+
+    return 0;
+}
+
+static int util_mark(chry_blockpool_t *bp, uint32_t op)
+{
+    int ret = util_mark_area(bp, op, (uintptr_t)(bp->pool), bp->block_cnt);
+
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    /*!< extra region from chry_blockpool_add_region */
+    for (uint32_t i = 0; (0 == ret) && (i < bp->region_cnt); i++) {
+        ret = util_mark_area(bp, op, (uintptr_t)(bp->regions[i].pool), bp->regions[i].block_cnt);
+    }
+#endif
+
+    return ret;
+}
+
+static bool util_fresh(void *next, uint32_t node_cnt, uint32_t leaf_cnt, uint32_t sub_cnt)
+{
+    uintptr_t addr = (uintptr_t)next & ~REGISTRY_TAG;
+
+    return ((addr >= (uintptr_t)(registry_node + node_cnt)) && (addr < (uintptr_t)(registry_node + CHRY_BLOCKPOOL_REGISTRY_NODE_MAX))) ||
+           ((addr >= (uintptr_t)(registry_leaf + leaf_cnt)) && (addr < (uintptr_t)(registry_leaf + CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX))) ||
+           ((addr >= (uintptr_t)(registry_sub + sub_cnt)) && (addr < (uintptr_t)(registry_sub + CHRY_BLOCKPOOL_REGISTRY_SUB_MAX)));
+}
+
+static void util_rollback(uint32_t node_cnt, uint32_t leaf_cnt, uint32_t sub_cnt)
+{
+    /*!< unhook node taken after count snapshot, only older node can point in, fresh node hold no pool */
+    for (uint32_t i = 0; i < node_cnt; i++) {
+        for (uint32_t j = 0; j < REGISTRY_FANOUT; j++) {
+            if (util_fresh(atomic_load_explicit(&registry_node[i][j], memory_order_relaxed), node_cnt, leaf_cnt, sub_cnt)) {
+                atomic_store_explicit(&registry_node[i][j], NULL, memory_order_release);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < leaf_cnt; i++) {
+        for (uint32_t j = 0; j < REGISTRY_FANOUT; j++) {
+            if (util_fresh(atomic_load_explicit(&registry_leaf[i][j], memory_order_relaxed), node_cnt, leaf_cnt, sub_cnt)) {
+                atomic_store_explicit(&registry_leaf[i][j], NULL, memory_order_release);
+            }
+        }
+    }
+
+    /*!< fresh node clean for next take */
+    for (uint32_t i = node_cnt; i < atomic_load_explicit(&registry_node_cnt, memory_order_relaxed); i++) {
+        for (uint32_t j = 0; j < REGISTRY_FANOUT; j++) {
+            atomic_store_explicit(&registry_node[i][j], NULL, memory_order_relaxed);
+        }
+    }
+
+    for (uint32_t i = leaf_cnt; i < atomic_load_explicit(&registry_leaf_cnt, memory_order_relaxed); i++) {
+        for (uint32_t j = 0; j < REGISTRY_FANOUT; j++) {
+            atomic_store_explicit(&registry_leaf[i][j], NULL, memory_order_relaxed);
+        }
+    }
+
+    atomic_store_explicit(&registry_node_cnt, node_cnt, memory_order_relaxed);
+    atomic_store_explicit(&registry_leaf_cnt, leaf_cnt, memory_order_relaxed);
+    atomic_store_explicit(&registry_sub_cnt, sub_cnt, memory_order_relaxed);
+}
+
+static bool util_out_pool(chry_blockpool_t *bp)
+{
+    if (util_out_range((uintptr_t)(bp->pool) + (uintptr_t)bp->block_cnt * bp->block_size - 1)) {
+        return true;
+    }
+
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    for (uint32_t i = 0; i < bp->region_cnt; i++) {
+        if (util_out_range((uintptr_t)(bp->regions[i].pool) + (uintptr_t)bp->regions[i].block_cnt * bp->block_size - 1)) {
+            return true;
+        }
+    }
+#endif
+
+    return false;
+}
+
+/*****************************************************************************
+* @brief        register blockpool block area and extra region to global
+*               registry, at most one pool may start in each registry region,
+*               register again after chry_blockpool_add_region
+* 
+* @param[in]    bp          blockpool instance
+* 
+* @retval int               0:Success 
+* @retval int               -1:Region already taken
+* @retval int               -2:No radix node
+* @retval int               -3:Address out of range
+*****************************************************************************/
+int chry_blockpool_register(chry_blockpool_t *bp)
+{
+    uint32_t node_cnt;
+    uint32_t leaf_cnt;
+    uint32_t sub_cnt;
+    int ret;
+
+    if (util_out_pool(bp)) {
+        return -3;
+    }
+
+    util_lock();
+
+    /*!< check without creating, then build every path before the first mark,
+         node run out only in prepare, roll the new nodes back, nothing changed */
+    ret = util_mark(bp, REGISTRY_CHECK);
+
+    if (0 == ret) {
+        node_cnt = atomic_load_explicit(&registry_node_cnt, memory_order_relaxed);
+        leaf_cnt = atomic_load_explicit(&registry_leaf_cnt, memory_order_relaxed);
+        sub_cnt = atomic_load_explicit(&registry_sub_cnt, memory_order_relaxed);
+        ret = util_mark(bp, REGISTRY_PREPARE);
+
+        if (0 == ret) {
+            util_mark(bp, REGISTRY_MARK);
+        } else {
+            util_rollback(node_cnt, leaf_cnt, sub_cnt);
+        }
+    }
+
+    util_unlock();
+
+    return ret;
+}
+
+/*****************************************************************************
+* @brief        unregister blockpool from global registry,
+*               no free may race with unregister for the same pool
+* 
+* @param[in]    bp          blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_unregister(chry_blockpool_t *bp)
+{
+    util_lock();
+    util_mark(bp, REGISTRY_UNMARK);
+    util_unlock();
+}
+
+/*****************************************************************************
+* @brief        lookup blockpool owning address, lock free, one radix walk,
+*               plus one slot pair load at a pool edge
+* 
+* @param[in]    addr        any address
+* 
+* @retval chry_blockpool_t* owner blockpool, NULL when not registered
+*****************************************************************************/
+chry_blockpool_t *chry_blockpool_lookup(const void *addr)
+{
+    uintptr_t address = (uintptr_t)addr;
+    _Atomic(void *) *entry;
+    _Atomic(void *) *pair;
+    void *cur;
+    chry_blockpool_t *bp;
+
+    if (util_out_range(address)) {
+        return NULL;
+    }
+
+    entry = util_entry(address >> REGISTRY_SPAN_SHIFT, false);
+
+    if (NULL == entry) {
+        return NULL;
+    }
+
+    /*!< span inside one pool answer at once, else one more load for region slot pair */
+    cur = atomic_load_explicit(entry, memory_order_acquire);
+
+    if (!((uintptr_t)cur & REGISTRY_TAG)) {
+        return (chry_blockpool_t *)cur;
+    }
+
+    pair = (_Atomic(void *) *)((uintptr_t)cur & ~REGISTRY_TAG) + 2 * ((address >> CHRY_BLOCKPOOL_REGISTRY_SHIFT) & (REGISTRY_SUB - 1));
+    bp = atomic_load_explicit(&pair[1], memory_order_acquire);
+
+    if ((NULL != bp) && (address >= util_start(bp, address >> CHRY_BLOCKPOOL_REGISTRY_SHIFT))) {
+        return bp;
+    }
+
+    return atomic_load_explicit(&pair[0], memory_order_acquire);
+}
+
+/*****************************************************************************
+* @brief        free one block to its owner blockpool, no pool argument,
+*               same lock rule as chry_blockpool_free of the owner
+* 
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr or not registered
+* @retval int               -2:Already free
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_free(void *addr)
+{
+    chry_blockpool_t *bp = chry_blockpool_lookup(addr);
+
+    if (NULL == bp) {
+        return -1;
+    }
+
+    return chry_blockpool_free(bp, addr);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_REGISTRY_H
+#define CHRY_BLOCKPOOL_REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+/*!< region size power of 2, at most one pool may start in one region */
+#ifndef CHRY_BLOCKPOOL_REGISTRY_SHIFT
+#define CHRY_BLOCKPOOL_REGISTRY_SHIFT 12
+#endif
+
+/*!< region per leaf entry power of 2, entry inside one pool hold the pool, entry at a pool edge point to a sub leaf */
+#ifndef CHRY_BLOCKPOOL_REGISTRY_SUB_BITS
+#define CHRY_BLOCKPOOL_REGISTRY_SUB_BITS 4
+#endif
+
+/*!< address bit covered, index bit per radix level, (addr - shift - sub) must be a multiple of bits */
+#if UINTPTR_MAX > 0xFFFFFFFFUL
+#ifndef CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS
+#define CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS 48
+#endif
+#else
+#ifndef CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS
+#define CHRY_BLOCKPOOL_REGISTRY_ADDR_BITS 32
+#endif
+#endif
+#ifndef CHRY_BLOCKPOOL_REGISTRY_BITS
+#define CHRY_BLOCKPOOL_REGISTRY_BITS 8
+#endif
+
+/*!< interior node count with root, leaf count, FANOUT entry each, a leaf cover 16 MB,
+     sub leaf count, 2 * SUB slot each, at most two per registered area, never returned */
+#if UINTPTR_MAX > 0xFFFFFFFFUL
+#ifndef CHRY_BLOCKPOOL_REGISTRY_NODE_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_NODE_MAX 16
+#endif
+#ifndef CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX 64
+#endif
+#ifndef CHRY_BLOCKPOOL_REGISTRY_SUB_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_SUB_MAX 256
+#endif
+#else
+#ifndef CHRY_BLOCKPOOL_REGISTRY_NODE_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_NODE_MAX 1
+#endif
+#ifndef CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX 16
+#endif
+#ifndef CHRY_BLOCKPOOL_REGISTRY_SUB_MAX
+#define CHRY_BLOCKPOOL_REGISTRY_SUB_MAX 32
+#endif
+#endif
+
+extern int chry_blockpool_register(chry_blockpool_t *bp);
+extern void chry_blockpool_unregister(chry_blockpool_t *bp);
+extern chry_blockpool_t *chry_blockpool_lookup(const void *addr);
+
+extern int chry_free(void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
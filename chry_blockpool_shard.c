@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_blockpool_shard.h"
+
+static uint32_t util_random(chry_blockpool_shard_t *shard)
+{
+    /*!< xorshift32, state never zero */
+    uint32_t x = shard->seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    shard->seed = x;
+
+    return x;
+}
+
+static uint32_t util_steal(chry_blockpool_shard_set_t *set, uint32_t id)
+{
+    chry_blockpool_shard_t *shard = &(set->shards[id]);
+    uint32_t others = set->shard_cnt - 1;
+    uint32_t start;
+
+    if (0 == others) {
+        return 0;
+    }
+
+    /*!< random first victim, then walk the others once */
+    start = util_random(shard) % others;
+
+    for (uint32_t i = 0; i < others; i++) {
+        chry_blockpool_mpmc_t *victim = &(set->shards[(id + 1 + (start + i) % others) % set->shard_cnt].mp);
+        uint32_t n = (chry_blockpool_mpmc_get_free(victim) + 1) / 2;
+
+        /*!< take at most half of victim free blocks, leave it the rest */
+        n = n > CHRY_BLOCKPOOL_SHARD_BATCH ? CHRY_BLOCKPOOL_SHARD_BATCH : n;
+        n = chry_blockpool_mpmc_alloc_burst(victim, shard->stolen, n);
+
+        if (n) {
+            return n;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        init sharded blockpool set,
+*               memory pool split evenly, one lock-free blockpool per shard
+* 
+* @param[in]    set         shard set instance
+* @param[in]    shards      shard array, shard_cnt element
+* @param[in]    shard_cnt   shard count
+* @param[in]    align       block align
+* @param[in]    block_size  block size in byte
+* @param[in]    pool        memory pool address, align to block align
+* @param[in]    size        memory size in byte
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_blockpool_shard_init(chry_blockpool_shard_set_t *set, chry_blockpool_shard_t *shards, uint32_t shard_cnt, uint32_t align, uint32_t block_size, void *pool, uint32_t size)
+{
+    uint32_t stride;
+
+    if ((0 == shard_cnt) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096)) {
+        return -1;
+    }
+
+    /*!< keep every shard start on block align and cache line */
+    stride = size / shard_cnt;
+    stride &= ~((align > CHRY_BLOCKPOOL_ALIGN_64 ? (0x1UL << align) : 64) - 1);
+
+    if (0 == stride) {
+        return -1;
+    }
+
+    set->shards = shards;
+    set->shard_cnt = shard_cnt;
+    set->stride = stride;
+    set->pool = pool;
+    chry_blockpool_calc_reciprocal(stride, &(set->stride_mul), &(set->stride_shift));
+
+    for (uint32_t i = 0; i < shard_cnt; i++) {
+        if (chry_blockpool_mpmc_init(&(shards[i].mp), align, block_size, (void *)((uintptr_t)pool + i * stride), stride)) {
+            return -1;
+        }
+
+        atomic_init(&(shards[i].stolen_cnt), 0);
+        shards[i].seed = (i + 1) * 0x9E3779B9UL;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        return stolen blocks held by one shard to their home shard,
+*               call from the shard owner, such as at worker exit
+* 
+* @param[in]    set         shard set instance
+* @param[in]    id          shard id
+* 
+*****************************************************************************/
+void chry_blockpool_shard_flush(chry_blockpool_shard_set_t *set, uint32_t id)
+{
+    chry_blockpool_shard_t *shard = &(set->shards[id]);
+    uint32_t cnt = atomic_load_explicit(&(shard->stolen_cnt), memory_order_relaxed);
+
+    while (cnt) {
+        atomic_store_explicit(&(shard->stolen_cnt), --cnt, memory_order_relaxed);
+        chry_blockpool_shard_free(set, shard->stolen[cnt]);
+    }
+}
+
+/*****************************************************************************
+* @brief        get shard set total size in block count
+* 
+* @param[in]    set         shard set instance
+* 
+* @retval uint32_t          total size in block count
+*****************************************************************************/
+uint32_t chry_blockpool_shard_get_size(chry_blockpool_shard_set_t *set)
+{
+    uint32_t size = 0;
+
+    for (uint32_t i = 0; i < set->shard_cnt; i++) {
+        size += chry_blockpool_mpmc_get_size(&(set->shards[i].mp));
+    }
+
+    return size;
+}
+
+/*****************************************************************************
+* @brief        get shard set free size in block count,
+*               stolen blocks not yet handed out count as free,
+*               any thread can call, approximate while owner alloc or free
+* 
+* @param[in]    set         shard set instance
+* 
+* @retval uint32_t          free size in block count
+*****************************************************************************/
+uint32_t chry_blockpool_shard_get_free(chry_blockpool_shard_set_t *set)
+{
+    uint32_t free = 0;
+
+    for (uint32_t i = 0; i < set->shard_cnt; i++) {
+        /*!< only owner write stolen count, relaxed read see some recent value */
+        free += chry_blockpool_mpmc_get_free(&(set->shards[i].mp)) + atomic_load_explicit(&(set->shards[i].stolen_cnt), memory_order_relaxed);
+    }
+
+    return free;
+}
+
+/*****************************************************************************
+* @brief        alloc one block for a shard owner,
+*               stolen blocks first, then own shard,
+*               own shard empty steal a batch from random victim lock-free,
+*               one owner thread per shard id
+* 
+* @param[in]    set         shard set instance
+* @param[in]    id          caller shard id
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem in every shard
+*****************************************************************************/
+int chry_blockpool_shard_alloc(chry_blockpool_shard_set_t *set, uint32_t id, void **addr)
+{
+    chry_blockpool_shard_t *shard = &(set->shards[id]);
+    uint32_t cnt = atomic_load_explicit(&(shard->stolen_cnt), memory_order_relaxed);
+
+    if (0 == cnt) {
+        if (0 == chry_blockpool_mpmc_alloc(&(shard->mp), addr)) {
+            return 0;
+        }
+
+        cnt = util_steal(set, id);
+
+        if (0 == cnt) {
+            return -1;
+        }
+    }
+
+    /*!< only owner write it, relaxed for get_free from other thread */
+    atomic_store_explicit(&(shard->stolen_cnt), --cnt, memory_order_relaxed);
+    *addr = shard->stolen[cnt];
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        free one block to its home shard,
+*               lock-free, any thread can call,
+*               double free is not checked
+* 
+* @param[in]    set         shard set instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success
+* @retval int               -1:Error addr
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_blockpool_shard_free(chry_blockpool_shard_set_t *set, void *addr)
+{
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(set->pool);
+
+    /*!< addr below pool wrap to large offset */
+    if (address >= (uintptr_t)set->shard_cnt * set->stride) {
+        return -1;
+    }
+
+    /*!< shard memory is contiguous, home shard by offset, offset below size fit 32 bit */
+    return chry_blockpool_mpmc_free(&(set->shards[chry_blockpool_calc_quotient((uint32_t)address, set->stride_mul, set->stride_shift)].mp), addr);
+}
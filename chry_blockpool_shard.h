@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_SHARD_H
+#define CHRY_BLOCKPOOL_SHARD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool_mpmc.h"
+
+#define CHRY_BLOCKPOOL_SHARD_BATCH 16
+
+typedef struct {
+    chry_blockpool_mpmc_t mp;                   /*!< Define the shard blockpool.        */
+    void *stolen[CHRY_BLOCKPOOL_SHARD_BATCH];   /*!< Define the stolen block stack.     */
+    CHRY_BLOCKPOOL_ATOMIC(uint32_t) stolen_cnt; /*!< Define the stolen block count.     */
+    uint32_t seed;                              /*!< Define the victim random state.    */
+} chry_blockpool_shard_t;
+
+typedef struct {
+    chry_blockpool_shard_t *shards; /*!< Define the shard array.              */
+    uint32_t shard_cnt;             /*!< Define the shard count.              */
+    uint32_t stride;                /*!< Define the shard memory size.        */
+    uint32_t stride_mul;            /*!< Define the shard size reciprocal.    */
+    uint32_t stride_shift;          /*!< Define the shard size power of 2.    */
+    void *pool;                     /*!< Define the memory pointer.           */
+} chry_blockpool_shard_set_t;
+
+extern int chry_blockpool_shard_init(chry_blockpool_shard_set_t *set, chry_blockpool_shard_t *shards, uint32_t shard_cnt, uint32_t align, uint32_t block_size, void *pool, uint32_t size);
+extern void chry_blockpool_shard_flush(chry_blockpool_shard_set_t *set, uint32_t id);
+
+extern uint32_t chry_blockpool_shard_get_size(chry_blockpool_shard_set_t *set);
+extern uint32_t chry_blockpool_shard_get_free(chry_blockpool_shard_set_t *set);
+
+extern int chry_blockpool_shard_alloc(chry_blockpool_shard_set_t *set, uint32_t id, void **addr);
+extern int chry_blockpool_shard_free(chry_blockpool_shard_set_t *set, void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+#include "chry_blockpool_wait.h"
+
+/*!< wait state live in chry_blockpool_t only with CHRY_BLOCKPOOL_WAIT in chry_blockpool_config.h */
+#ifdef CHRY_BLOCKPOOL_WAIT
+
+/*!< without membarrier a wakeup may be missed, sleep in short slice */
+#define UTIL_SLICE_NS 1000000ULL
+
+static _Atomic int wait_membarrier = 0; /*!< 0:Unknown 1:Ready -1:Unavailable */
+
+static bool util_membarrier_ready(void)
+{
+    int state = atomic_load_explicit(&wait_membarrier, memory_order_relaxed);
+
+    if (0 == state) {
+        state = syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) ? -1 : 1;
+        atomic_store_explicit(&wait_membarrier, state, memory_order_relaxed);
+    }
+
+    return 1 == state;
+}
+
+static void util_barrier(bool membarrier)
+{
+    /*!< full barrier on every running thread, free side pay nothing */
+    if (!membarrier || syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0)) {
+        atomic_thread_fence(memory_order_seq_cst);
+    }
+}
+
+static uint64_t util_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*****************************************************************************
+* @brief        alloc one block, sleep on futex until a free or timeout,
+*               free only check one flag when nobody sleep,
+*               same lock rule as chry_blockpool_alloc, not for lifo mode
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    addr        pointer to save alloc block pointer
+* @param[in]    timeout_ns  max wait in ns, CHRY_BLOCKPOOL_WAIT_FOREVER no limit
+* 
+* @retval int               0:Success -1:Timeout -3:Error, lifo mode
+*****************************************************************************/
+int chry_blockpool_alloc_wait(chry_blockpool_t *bp, void **addr, uint64_t timeout_ns)
+{
+    bool membarrier;
+    uint64_t deadline;
+    uint64_t now;
+    uint64_t sleep;
+    uint32_t seq;
+    struct timespec ts;
+    int ret = -1;
+
+    if (0 == chry_blockpool_alloc(bp, addr)) {
+        return 0;
+    }
+
+    /*!< lifo alloc and free share one lock, sleep with it would block free */
+    if (bp->flags & CHRY_BLOCKPOOL_FLAG_LIFO) {
+        return -3;
+    }
+
+    membarrier = util_membarrier_ready();
+    now = util_now();
+    deadline = (timeout_ns > UINT64_MAX - now) ? UINT64_MAX : now + timeout_ns;
+
+    atomic_fetch_add_explicit(&(bp->sleepers), 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&(bp->waiters), 1, memory_order_relaxed);
+
+    for (;;) {
+        /*!< sample futex word before last check, later free change it */
+        seq = atomic_load_explicit(&(bp->wake_seq), memory_order_acquire);
+
+        /*!< waiters visible to free, or its block visible to us */
+        util_barrier(membarrier);
+
+        if (0 == chry_blockpool_alloc(bp, addr)) {
+            ret = 0;
+            break;
+        }
+
+        now = util_now();
+
+        if (now >= deadline) {
+            break;
+        }
+
+        sleep = deadline - now;
+        sleep = (!membarrier && (sleep > UTIL_SLICE_NS)) ? UTIL_SLICE_NS : sleep;
+        ts.tv_sec = (time_t)(sleep / 1000000000ULL);
+        ts.tv_nsec = (long)(sleep % 1000000000ULL);
+
+        syscall(SYS_futex, &(bp->wake_seq), FUTEX_WAIT_PRIVATE, seq, &ts, NULL, 0);
+    }
+
+    atomic_fetch_sub_explicit(&(bp->waiters), 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&(bp->sleepers), 1, memory_order_relaxed);
+
+    return ret;
+}
+
+static bool util_event_ready(chry_blockpool_t *bp)
+{
+    /*!< remote freed block wait on its list until next alloc, count it as free */
+    return chry_blockpool_get_free(bp) + atomic_load_explicit(&(bp->remote_cnt), memory_order_relaxed) >= bp->low_water;
+}
+
+static void util_event_fire(chry_blockpool_t *bp)
+{
+    uint32_t armed = 1;
+    uint64_t one = 1;
+    ssize_t ret;
+
+    /*!< first thread see enough free block take the edge, others coalesce */
+    if (atomic_compare_exchange_strong_explicit(&(bp->armed), &armed, 0, memory_order_relaxed, memory_order_relaxed)) {
+        atomic_fetch_sub_explicit(&(bp->waiters), 1, memory_order_relaxed);
+
+        /*!< counter never near overflow, reader drain each edge */
+        ret = write(bp->event_fd, &one, sizeof(one));
+        (void)ret;
+    }
+}
+
+/*****************************************************************************
+* @brief        open readiness eventfd, readable once free block reach
+*               low water after chry_blockpool_event_arm, edge triggered
+* 
+* @param[in]    bp          blockpool instance
+* @param[in]    low_water   free block count to signal, 0 same as 1
+* 
+* @retval int               eventfd, -1:Error
+*****************************************************************************/
+int chry_blockpool_event_open(chry_blockpool_t *bp, uint32_t low_water)
+{
+    if (bp->event_fd >= 0) {
+        return -1;
+    }
+
+    bp->low_water = low_water ? low_water : 1;
+    bp->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    return bp->event_fd;
+}
+
+/*****************************************************************************
+* @brief        close readiness eventfd, no free may run
+* 
+* @param[in]    bp          blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_event_close(chry_blockpool_t *bp)
+{
+    uint32_t armed = 1;
+
+    if (bp->event_fd < 0) {
+        return;
+    }
+
+    if (atomic_compare_exchange_strong_explicit(&(bp->armed), &armed, 0, memory_order_relaxed, memory_order_relaxed)) {
+        atomic_fetch_sub_explicit(&(bp->waiters), 1, memory_order_relaxed);
+    }
+
+    close(bp->event_fd);
+    bp->event_fd = -1;
+}
+
+/*****************************************************************************
+* @brief        arm readiness event after alloc fail or free block run low,
+*               eventfd become readable once free block reach low water,
+*               fire at once when already there, read eventfd before arm again,
+*               one event loop thread arm
+* 
+* @param[in]    bp          blockpool instance
+* 
+* @retval int               0:Success -3:Error, eventfd not open
+*****************************************************************************/
+int chry_blockpool_event_arm(chry_blockpool_t *bp)
+{
+    if (bp->event_fd < 0) {
+        return -3;
+    }
+
+    if (0 == atomic_exchange_explicit(&(bp->armed), 1, memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&(bp->waiters), 1, memory_order_relaxed);
+    }
+
+    /*!< armed visible to free, or its block visible to the check below */
+    util_barrier(util_membarrier_ready());
+
+    if (util_event_ready(bp)) {
+        util_event_fire(bp);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        wake sleeping alloc and fire armed event, called by free
+*               when waiters set
+* 
+* @param[in]    bp          blockpool instance
+* 
+*****************************************************************************/
+void chry_blockpool_wake(chry_blockpool_t *bp)
+{
+    if (atomic_load_explicit(&(bp->armed), memory_order_relaxed) && util_event_ready(bp)) {
+        util_event_fire(bp);
+    }
+
+    if (atomic_load_explicit(&(bp->sleepers), memory_order_relaxed)) {
+        atomic_fetch_add_explicit(&(bp->wake_seq), 1, memory_order_release);
+        syscall(SYS_futex, &(bp->wake_seq), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+#endif
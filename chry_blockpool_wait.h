@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_BLOCKPOOL_WAIT_H
+#define CHRY_BLOCKPOOL_WAIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+#define CHRY_BLOCKPOOL_WAIT_FOREVER UINT64_MAX
+
+extern int chry_blockpool_alloc_wait(chry_blockpool_t *bp, void **addr, uint64_t timeout_ns);
+
+extern int chry_blockpool_event_open(chry_blockpool_t *bp, uint32_t low_water);
+extern void chry_blockpool_event_close(chry_blockpool_t *bp);
+extern int chry_blockpool_event_arm(chry_blockpool_t *bp);
+
+extern void chry_blockpool_wake(chry_blockpool_t *bp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_sizeclass_pool.h"
+
+static uint32_t util_class_step(uint32_t size, uint32_t granule)
+{
+    uint32_t top = size;
+
+    /*!< keep highest bit only, four class per power of 2, waste below 25% */
+    while (top & (top - 1)) {
+        top &= top - 1;
+    }
+
+    return (top / 4) > granule ? (top / 4) : granule;
+}
+
+static int32_t util_class_index(chry_sizeclass_pool_t *sp, void *addr)
+{
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)(sp->pool);
+
+    /*!< addr below pool wrap to large offset */
+    if (address >= (uintptr_t)sp->class_cnt * sp->stride) {
+        return -1;
+    }
+
+    /*!< offset below size fit 32 bit, quotient by reciprocal multiply */
+    return (int32_t)chry_blockpool_calc_quotient((uint32_t)address, sp->stride_mul, sp->stride_shift);
+}
+
+/*****************************************************************************
+* @brief        init size class pool,
+*               lookup table then one blockpool per class, equal memory each,
+*               class size from min_size, four class per power of 2, up to max_size
+* 
+* @param[in]    sp          size class pool instance
+* @param[in]    align       block align, also lookup granule
+* @param[in]    min_size    smallest class size in byte
+* @param[in]    max_size    largest class size in byte
+* @param[in]    pool        memory pool address, align to block align
+* @param[in]    size        memory size in byte
+* @param[in]    flags       CHRY_BLOCKPOOL_FLAG_xxx for every class
+* 
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int chry_sizeclass_pool_init(chry_sizeclass_pool_t *sp, uint32_t align, uint32_t min_size, uint32_t max_size, void *pool, uint32_t size, uint32_t flags)
+{
+    uint32_t granule;
+    uint32_t table;
+    uint32_t class_size;
+    uint32_t cnt = 0;
+
+    /*!< check param */
+    if ((0 == min_size) || (min_size > max_size) || (align < CHRY_BLOCKPOOL_ALIGN_4) || (align > CHRY_BLOCKPOOL_ALIGN_4096)) {
+        return -1;
+    }
+
+    granule = 0x1UL << align;
+    max_size = (max_size + granule - 1) & ~(granule - 1);
+
+    /*!< geometric class size, each a multiple of granule */
+    for (class_size = (min_size + granule - 1) & ~(granule - 1); class_size < max_size; class_size += util_class_step(class_size, granule)) {
+        if (cnt == CHRY_SIZECLASS_MAX - 1) {
+            return -1;
+        }
+
+        sp->class_size[cnt++] = class_size;
+    }
+
+    sp->class_size[cnt++] = max_size;
+
+    /*!< one byte per granule up to max size, class memory keep pointer and block align */
+    table = (max_size >> align) + 1;
+    table = (table + granule - 1) & ~(granule - 1);
+    table = (table + sizeof(void *) - 1) & ~(uint32_t)(sizeof(void *) - 1);
+
+    if (size <= table) {
+        return -1;
+    }
+
+    sp->class_cnt = cnt;
+    sp->granule_shift = align;
+    sp->max_size = max_size;
+    sp->lookup = (uint8_t *)pool;
+    sp->pool = (void *)((uintptr_t)pool + table);
+    sp->stride = ((size - table) / cnt) & ~((granule > sizeof(void *) ? granule : sizeof(void *)) - 1);
+
+    if (0 == sp->stride) {
+        return -1;
+    }
+
+    chry_blockpool_calc_reciprocal(sp->stride, &(sp->stride_mul), &(sp->stride_shift));
+
+    /*!< lookup entry i serve request size up to i granule */
+    for (uint32_t i = 0, c = 0; i <= (max_size >> align); i++) {
+        while ((i << align) > sp->class_size[c]) {
+            c++;
+        }
+
+        sp->lookup[i] = (uint8_t)c;
+    }
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        if (chry_blockpool_init_ex(&(sp->classes[i]), align, sp->class_size[i], (void *)((uintptr_t)(sp->pool) + i * sp->stride), sp->stride, flags)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        reset size class pool, free all block of every class,
+*               should be add lock in mutithread
+* 
+* @param[in]    sp          size class pool instance
+* 
+*****************************************************************************/
+void chry_sizeclass_pool_reset(chry_sizeclass_pool_t *sp)
+{
+    for (uint32_t i = 0; i < sp->class_cnt; i++) {
+        chry_blockpool_reset(&(sp->classes[i]));
+    }
+}
+
+/*****************************************************************************
+* @brief        get class serving a request size, table lookup
+* 
+* @param[in]    sp          size class pool instance
+* @param[in]    size        request size in byte
+* 
+* @retval uint32_t          class index, class_cnt when size too large
+*****************************************************************************/
+uint32_t chry_sizeclass_pool_get_class(chry_sizeclass_pool_t *sp, uint32_t size)
+{
+    if (size > sp->max_size) {
+        return sp->class_cnt;
+    }
+
+    return sp->lookup[(size + (0x1UL << sp->granule_shift) - 1) >> sp->granule_shift];
+}
+
+/*****************************************************************************
+* @brief        get block size of the class a block belongs to
+* 
+* @param[in]    sp          size class pool instance
+* @param[in]    addr        block pointer
+* 
+* @retval uint32_t          block size in byte, 0 when addr not in pool
+*****************************************************************************/
+uint32_t chry_sizeclass_pool_get_block_size(chry_sizeclass_pool_t *sp, void *addr)
+{
+    int32_t idx = util_class_index(sp, addr);
+
+    return (idx < 0) ? 0 : sp->class_size[idx];
+}
+
+/*****************************************************************************
+* @brief        alloc one block fit size from its class,
+*               a class run dry does not borrow from larger class,
+*               same lock rule as chry_blockpool_alloc
+* 
+* @param[in]    sp          size class pool instance
+* @param[in]    size        request size in byte
+* @param[in]    addr        pointer to save alloc block pointer
+* 
+* @retval int               0:Success -1:Nomem or size too large
+*****************************************************************************/
+int chry_sizeclass_pool_alloc(chry_sizeclass_pool_t *sp, uint32_t size, void **addr)
+{
+    uint32_t idx = chry_sizeclass_pool_get_class(sp, size);
+
+    if (idx >= sp->class_cnt) {
+        return -1;
+    }
+
+    return chry_blockpool_alloc(&(sp->classes[idx]), addr);
+}
+
+/*****************************************************************************
+* @brief        free one block to its class, class found by address,
+*               same lock rule as chry_blockpool_free
+* 
+* @param[in]    sp          size class pool instance
+* @param[in]    addr        pointer to free block
+* 
+* @retval int               0:Success 
+* @retval int               -1:Error addr
+* @retval int               -2:Already free
+* @retval int               -3:Error
+*****************************************************************************/
+int chry_sizeclass_pool_free(chry_sizeclass_pool_t *sp, void *addr)
+{
+    int32_t idx = util_class_index(sp, addr);
+
+    if (idx < 0) {
+        return -1;
+    }
+
+    return chry_blockpool_free(&(sp->classes[idx]), addr);
+}
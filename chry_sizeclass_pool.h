@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CHRY_SIZECLASS_POOL_H
+#define CHRY_SIZECLASS_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_blockpool.h"
+
+#ifndef CHRY_SIZECLASS_MAX
+#define CHRY_SIZECLASS_MAX 32
+#endif
+
+typedef struct {
+    chry_blockpool_t classes[CHRY_SIZECLASS_MAX]; /*!< Define the class blockpool.         */
+    uint32_t class_size[CHRY_SIZECLASS_MAX];      /*!< Define the class block size.        */
+    uint32_t class_cnt;                           /*!< Define the class count.             */
+    uint32_t granule_shift;                       /*!< Define the lookup granule power of 2. */
+    uint32_t max_size;                            /*!< Define the largest class size.      */
+    uint32_t stride;                              /*!< Define the class memory size.       */
+    uint32_t stride_mul;                          /*!< Define the class size reciprocal.   */
+    uint32_t stride_shift;                        /*!< Define the class size power of 2.   */
+    uint8_t *lookup;                              /*!< Define the size to class table.     */
+    void *pool;                                   /*!< Define the first class memory.      */
+} chry_sizeclass_pool_t;
+
+extern int chry_sizeclass_pool_init(chry_sizeclass_pool_t *sp, uint32_t align, uint32_t min_size, uint32_t max_size, void *pool, uint32_t size, uint32_t flags);
+extern void chry_sizeclass_pool_reset(chry_sizeclass_pool_t *sp);
+
+extern uint32_t chry_sizeclass_pool_get_class(chry_sizeclass_pool_t *sp, uint32_t size);
+extern uint32_t chry_sizeclass_pool_get_block_size(chry_sizeclass_pool_t *sp, void *addr);
+
+extern int chry_sizeclass_pool_alloc(chry_sizeclass_pool_t *sp, uint32_t size, void **addr);
+extern int chry_sizeclass_pool_free(chry_sizeclass_pool_t *sp, void *addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
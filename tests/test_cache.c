@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include "chry_blockpool_cache.h"
+#include "test_util.h"
+
+#define POOL_SIZE  16384
+#define BLOCK_SIZE 32
+#define MAG_SIZE   8
+#define MAG_CNT    12
+#define PAIR_CNT   2
+#define ROUNDS     20000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static void *magmem[MAG_CNT * CHRY_BLOCKPOOL_MAG_SIZE(MAG_SIZE) / sizeof(void *)];
+static chry_blockpool_t bp;
+static chry_blockpool_depot_t depot;
+
+/*!< one handoff queue per pair, alloc thread cache -> free thread cache */
+static test_queue_t queue[PAIR_CNT];
+static chry_blockpool_cache_t cache[2 * PAIR_CNT];
+static _Atomic int error;
+
+static void *alloc_thread(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    test_queue_t *q = &queue[id / 2];
+    void *addr;
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        while (chry_blockpool_cache_alloc(&cache[id], &addr)) {
+            sched_yield();
+        }
+        *(uint32_t *)addr = i;
+        test_queue_push(q, addr);
+    }
+
+    test_queue_close(q);
+    chry_blockpool_cache_flush(&cache[id]);
+
+    return NULL;
+}
+
+static void *free_thread(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    test_queue_t *q = &queue[id / 2];
+    uint32_t seq;
+    uint32_t *block;
+
+    /*!< full magazine go to depot, alloc thread pick it up there */
+    while (NULL != (block = test_queue_pop(q, &seq))) {
+        if (*block != seq) {
+            atomic_store(&error, 1);
+        }
+        chry_blockpool_cache_free(&cache[id], block);
+    }
+
+    chry_blockpool_cache_flush(&cache[id]);
+
+    return NULL;
+}
+
+static int depot_trade(void)
+{
+    chry_blockpool_cache_t a;
+    chry_blockpool_cache_t b;
+    void *addrs[3 * MAG_SIZE];
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool)));
+    CHECK(0 == chry_blockpool_depot_init(&depot, &bp, MAG_SIZE, magmem, sizeof(magmem)));
+    CHECK(0 == chry_blockpool_cache_init(&a, &depot));
+    CHECK(0 == chry_blockpool_cache_init(&b, &depot));
+
+    /*!< empty cache refill a whole magazine from blockpool */
+    CHECK(0 == chry_blockpool_cache_alloc(&a, &addrs[0]));
+    CHECK(MAG_SIZE == chry_blockpool_get_used(&bp));
+
+    for (uint32_t i = 1; i < 3 * MAG_SIZE; i++) {
+        CHECK(0 == chry_blockpool_cache_alloc(&a, &addrs[i]));
+    }
+    CHECK(3 * MAG_SIZE == chry_blockpool_get_used(&bp));
+
+    /*!< both magazine full, one go to depot, blockpool untouched */
+    for (uint32_t i = 0; i < 3 * MAG_SIZE; i++) {
+        chry_blockpool_cache_free(&a, addrs[i]);
+    }
+    CHECK(3 * MAG_SIZE == chry_blockpool_get_used(&bp));
+
+    /*!< other cache take the full magazine from depot */
+    for (uint32_t i = 0; i < MAG_SIZE; i++) {
+        CHECK(0 == chry_blockpool_cache_alloc(&b, &addr));
+        CHECK(3 * MAG_SIZE == chry_blockpool_get_used(&bp));
+        chry_blockpool_cache_free(&b, addr);
+    }
+
+    chry_blockpool_cache_flush(&a);
+    chry_blockpool_cache_flush(&b);
+    chry_blockpool_depot_drain(&depot);
+    CHECK(0 == chry_blockpool_get_used(&bp));
+
+    return 0;
+}
+
+static int cache_run(void)
+{
+    pthread_t thread[2 * PAIR_CNT];
+
+    CHECK(0 == chry_blockpool_init(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool)));
+    CHECK(0 == chry_blockpool_depot_init(&depot, &bp, MAG_SIZE, magmem, sizeof(magmem)));
+
+    /*!< every cache take its two magazine before any thread trade */
+    for (uint32_t i = 0; i < 2 * PAIR_CNT; i++) {
+        CHECK(0 == chry_blockpool_cache_init(&cache[i], &depot));
+    }
+
+    for (uintptr_t i = 0; i < PAIR_CNT; i++) {
+        test_queue_init(&queue[i]);
+        pthread_create(&thread[2 * i], NULL, alloc_thread, (void *)(2 * i));
+        pthread_create(&thread[2 * i + 1], NULL, free_thread, (void *)(2 * i + 1));
+    }
+
+    for (uint32_t i = 0; i < 2 * PAIR_CNT; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    chry_blockpool_depot_drain(&depot);
+
+    CHECK(0 == atomic_load(&error));
+    CHECK(0 == chry_blockpool_get_used(&bp));
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    if (depot_trade() || cache_run()) {
+        fail = 1;
+    }
+
+    printf("test_cache %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstdio>
+#include "chry_blockpool.h"
+#include "chry_blockpool_cache.h"
+#include "chry_blockpool_elastic.h"
+#include "chry_blockpool_mmap.h"
+#include "chry_blockpool_mpmc.h"
+#include "chry_blockpool_numa.h"
+#include "chry_blockpool_page.h"
+#include "chry_blockpool_percpu.h"
+#include "chry_blockpool_registry.h"
+#include "chry_blockpool_shard.h"
+#include "chry_blockpool_wait.h"
+#include "chry_sizeclass_pool.h"
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: %s\n", __func__, __LINE__, #cond);               \
+            return -1;                                                      \
+        }                                                                   \
+    } while (0)
+
+static uint64_t mempool[512];
+
+/*!< every public header parse as C++, struct built by C core used from C++ */
+static int cxx_run(void)
+{
+    chry_blockpool_t bp;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, 32, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_BITMAP));
+    CHECK(0 == chry_blockpool_alloc(&bp, &addr));
+    CHECK(chry_blockpool_get_used(&bp) == 1);
+    CHECK(0 == chry_blockpool_free(&bp, addr));
+    CHECK(-2 == chry_blockpool_free(&bp, addr));
+    CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = cxx_run() ? 1 : 0;
+
+    printf("test_cxx %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "chry_blockpool_elastic.h"
+#include "test_util.h"
+
+#define BLOCK_SIZE   64
+#define RESERVE_SIZE 0x100000
+#define STEP_SIZE    0x4000
+#define KEEP_CNT     8
+
+static void *hold[RESERVE_SIZE / BLOCK_SIZE];
+static int probe[2];
+
+/*!< kernel copy from a decommitted page fail with EFAULT instead of a fault */
+static int is_committed(void *addr)
+{
+    return 1 == write(probe[1], addr, 1);
+}
+
+/*!< alloc until nomem, every block writable, commit grow one step at a time */
+static int fill(chry_blockpool_elastic_t *ep, uint32_t *cnt)
+{
+    uint32_t commit = chry_blockpool_elastic_get_commit(ep);
+
+    while (0 == chry_blockpool_elastic_alloc(ep, &hold[*cnt])) {
+        memset(hold[*cnt], 0xa5, BLOCK_SIZE);
+        (*cnt)++;
+
+        if (chry_blockpool_elastic_get_commit(ep) != commit) {
+            CHECK((chry_blockpool_elastic_get_commit(ep) == commit + STEP_SIZE) ||
+                  (chry_blockpool_elastic_get_commit(ep) == ep->meta_offset));
+            commit = chry_blockpool_elastic_get_commit(ep);
+        }
+    }
+
+    CHECK(ep->meta_offset == chry_blockpool_elastic_get_commit(ep));
+    CHECK(*cnt == chry_blockpool_get_size(&ep->bp));
+
+    return 0;
+}
+
+static int elastic_run(void)
+{
+    chry_blockpool_elastic_t ep;
+    uint8_t *base;
+    uint32_t cnt = 0;
+
+    CHECK(0 == pipe(probe));
+    CHECK(0 == chry_blockpool_elastic_init(&ep, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, RESERVE_SIZE, STEP_SIZE, 0));
+    base = (uint8_t *)ep.base;
+
+    /*!< only the first step committed, metadata past the block area */
+    CHECK(STEP_SIZE == chry_blockpool_elastic_get_commit(&ep));
+    CHECK(is_committed(base));
+    CHECK(!is_committed(base + STEP_SIZE));
+    CHECK(EFAULT == errno);
+
+    CHECK(0 == fill(&ep, &cnt));
+    CHECK(is_committed(base + ep.meta_offset - 1));
+
+    /*!< free all but the lowest blocks, shrink back to one step */
+    while (cnt > KEEP_CNT) {
+        CHECK(0 == chry_blockpool_elastic_free(&ep, hold[--cnt]));
+    }
+    CHECK(-2 == chry_blockpool_elastic_free(&ep, hold[cnt]));
+    CHECK(0 == chry_blockpool_elastic_shrink(&ep));
+    CHECK(STEP_SIZE == chry_blockpool_elastic_get_commit(&ep));
+    CHECK(KEEP_CNT == chry_blockpool_get_used(&ep.bp));
+    CHECK(!is_committed(base + STEP_SIZE));
+    CHECK(!is_committed(base + ep.meta_offset - ep.page_size));
+    CHECK(is_committed(hold[KEEP_CNT - 1]));
+
+    /*!< kept block untouched, regrow over the released range */
+    for (uint32_t i = 0; i < KEEP_CNT; i++) {
+        CHECK(0xa5 == ((uint8_t *)hold[i])[BLOCK_SIZE - 1]);
+    }
+    CHECK(0 == fill(&ep, &cnt));
+
+    while (cnt) {
+        CHECK(0 == chry_blockpool_elastic_free(&ep, hold[--cnt]));
+    }
+    CHECK(0 == chry_blockpool_elastic_shrink(&ep));
+    CHECK(STEP_SIZE == chry_blockpool_elastic_get_commit(&ep));
+
+    chry_blockpool_elastic_deinit(&ep);
+    close(probe[0]);
+    close(probe[1]);
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = elastic_run() ? 1 : 0;
+
+    printf("test_elastic %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
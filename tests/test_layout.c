@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include "test_util.h"
+
+/*!< build core in, check static closed form bound against settled count */
+#include "chry_blockpool.c"
+
+/*!< largest pool init on heap, larger only run calc layout */
+#define INIT_MAX 0x100000
+
+/*!< bitmap word and ringbuffer align round up cost at most this many block past the closed form bound */
+#define SETTLE_MAX 16
+
+static int layout_check(uint32_t block_size, uint32_t size, uint32_t flags)
+{
+    chry_blockpool_layout_t layout;
+    chry_blockpool_t bp;
+    uint64_t bound;
+    uint64_t end;
+    uint64_t ring;
+    void *pool;
+
+    if (chry_blockpool_calc_layout(&layout, CHRY_BLOCKPOOL_ALIGN_4, block_size, size, flags)) {
+        /*!< pool smaller than one block has no layout */
+        CHECK(size < block_size);
+        return 0;
+    }
+
+    CHECK(layout.block_cnt > 0);
+    CHECK((uint64_t)layout.block_cnt * layout.block_size + layout.map_size + layout.rb_size + layout.waste_size <= size);
+
+    /*!< end offset recomputed in 64 bit from block count alone, a wrapped layout field can not hide it */
+    end = (uint64_t)layout.block_cnt * layout.block_size;
+    if (flags & CHRY_BLOCKPOOL_FLAG_BITMAP) {
+        end += ((uint64_t)layout.block_cnt + 31) / 32 * sizeof(uint32_t) * 2;
+    }
+    if (layout.entry_size) {
+        end = (end + layout.entry_size - 1) / layout.entry_size * layout.entry_size;
+        CHECK(end == layout.rb_offset);
+        for (ring = 1; ring < (uint64_t)layout.block_cnt * layout.entry_size; ring <<= 1) {
+        }
+        CHECK(ring == layout.rb_size);
+        end += ring;
+    }
+    CHECK(end <= size);
+    CHECK(end + layout.waste_size == size);
+
+    /*!< ringbuffer after block area and bitmap, hold every block, entry moved by one aligned load or store */
+    if (layout.rb_size) {
+        CHECK(layout.rb_offset >= layout.block_cnt * layout.block_size + layout.map_size);
+        CHECK(0 == layout.rb_offset % layout.entry_size);
+        CHECK(layout.rb_size / layout.entry_size >= layout.block_cnt);
+    }
+
+    /*!< settle step count is bound minus block count, ringbuffer cap bound the same way calc layout does */
+    bound = util_layout_cnt(layout.block_size, flags, size - layout.rb_size);
+    if (layout.entry_size && (bound > layout.rb_size / layout.entry_size)) {
+        bound = layout.rb_size / layout.entry_size;
+    }
+
+    CHECK(bound >= layout.block_cnt);
+    CHECK(bound - layout.block_cnt <= SETTLE_MAX);
+
+    /*!< init take the same layout */
+    if (size <= INIT_MAX) {
+        pool = malloc(size);
+        CHECK(NULL != pool);
+        CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_4, block_size, pool, size, flags));
+        CHECK(chry_blockpool_get_size(&bp) == layout.block_cnt);
+        free(pool);
+    }
+
+    return 0;
+}
+
+/*!< reciprocal quotient exact for every dividend, not only block multiple */
+static int quotient_check(void)
+{
+    static const uint32_t edges[] = { 0, 1, 2, 3, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFE, 0xFFFFFFFF };
+    uint32_t x = 0x12345678;
+    uint32_t divisor;
+    uint32_t mul;
+    uint32_t shift;
+    uint32_t n;
+
+    for (uint32_t i = 0; i < 20000; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+
+        /*!< small, power of 2, then full range divisor */
+        divisor = (i < 5000) ? (i + 1) : (i < 5032) ? (0x1UL << (i - 5000)) : (x >> (x & 31)) | 1;
+        chry_blockpool_calc_reciprocal(divisor, &mul, &shift);
+
+        for (uint32_t e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+            CHECK(chry_blockpool_calc_quotient(edges[e], mul, shift) == edges[e] / divisor);
+        }
+
+        for (uint32_t j = 0; j < 16; j++) {
+            n = x * (j * 2 + 1) + j;
+            CHECK(chry_blockpool_calc_quotient(n, mul, shift) == n / divisor);
+            CHECK(chry_blockpool_calc_quotient(divisor * j - 1, mul, shift) == (divisor * j - 1) / divisor);
+        }
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t flags[] = {
+        0,
+        CHRY_BLOCKPOOL_FLAG_BITMAP,
+        CHRY_BLOCKPOOL_FLAG_INDEX,
+        CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_INDEX,
+        CHRY_BLOCKPOOL_FLAG_LIFO,
+        CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_LIFO,
+    };
+    static const uint32_t sizes[] = { 256, 4096, 65536 + 100, 0x100000, 0x1234567, 0x80000001, 0xF0000000, 0xFFFFFFFF };
+    static const uint32_t block_sizes[] = { 4, 8, 24, 64, 1000 };
+    int fail = quotient_check() ? 1 : 0;
+
+    for (uint32_t f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+        for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            for (uint32_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++) {
+                if (layout_check(block_sizes[b], sizes[s], flags[f])) {
+                    printf("size 0x%08x block %u flags 0x%02x failed\n", sizes[s], block_sizes[b], flags[f]);
+                    fail = 1;
+                }
+            }
+        }
+    }
+
+    printf("test_layout %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
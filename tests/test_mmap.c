@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "chry_blockpool_mmap.h"
+#include "test_util.h"
+
+#define BLOCK_SIZE 64
+#define POOL_SIZE  100000
+
+static size_t hugepage_size(void)
+{
+    FILE *fp = fopen("/proc/meminfo", "r");
+    unsigned long kb = 0;
+    char line[128];
+
+    if (NULL != fp) {
+        while (fgets(line, sizeof(line), fp) && (1 != sscanf(line, "Hugepagesize: %lu kB", &kb))) {
+        }
+        fclose(fp);
+    }
+
+    return kb ? (size_t)kb * 1024 : (size_t)2 * 1024 * 1024;
+}
+
+static int mmap_run(uint32_t map_flags)
+{
+    chry_blockpool_mmap_t mp;
+    size_t huge = hugepage_size();
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint32_t cnt = 0;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_create_mmap(&mp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, POOL_SIZE, CHRY_BLOCKPOOL_FLAG_LIFO, map_flags));
+
+    /*!< hugetlb only when asked, no reserved hugetlb page fall back to base page */
+    CHECK((map_flags & CHRY_BLOCKPOOL_MMAP_HUGETLB) || !mp.hugetlb);
+    CHECK(mp.page_size == (mp.hugetlb ? huge : page));
+    CHECK(mp.map_size >= POOL_SIZE);
+    CHECK(0 == mp.map_size % mp.page_size);
+
+    /*!< hugepage asked, mapping aligned for a hugepage either way */
+    if (map_flags & (CHRY_BLOCKPOOL_MMAP_HUGETLB | CHRY_BLOCKPOOL_MMAP_THP)) {
+        CHECK(0 == (uintptr_t)mp.base % huge);
+        CHECK(0 == mp.map_size % huge);
+    } else {
+        CHECK(mp.map_size < POOL_SIZE + page);
+    }
+
+    /*!< pool keep caller size, every block writable */
+    while (0 == chry_blockpool_alloc(&mp.bp, &addr)) {
+        CHECK((uintptr_t)addr - (uintptr_t)mp.base < POOL_SIZE);
+        memset(addr, 0x5a, BLOCK_SIZE);
+        cnt++;
+    }
+
+    CHECK(cnt == chry_blockpool_get_size(&mp.bp));
+    CHECK(cnt == POOL_SIZE / BLOCK_SIZE);
+
+    chry_blockpool_destroy_mmap(&mp);
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    /*!< every hugetlb, thp, populate and touch combination */
+    for (uint32_t map_flags = 0; map_flags < 0x10; map_flags++) {
+        if (mmap_run(map_flags)) {
+            printf("map_flags 0x%02x failed\n", map_flags);
+            fail = 1;
+        }
+    }
+
+    printf("test_mmap %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
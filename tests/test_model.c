@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "chry_blockpool.h"
+#include "test_util.h"
+
+#define POOL_SIZE  4096
+#define MAX_LIVE   256
+#define ROUNDS     20000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+
+static void *live[MAX_LIVE];
+static uint32_t live_cnt;
+
+static int is_live(void *addr)
+{
+    for (uint32_t i = 0; i < live_cnt; i++) {
+        if (live[i] == addr) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void *take_live(uint32_t idx)
+{
+    void *addr = live[idx];
+
+    live[idx] = live[--live_cnt];
+    return addr;
+}
+
+static int model_run(uint32_t block_size, uint32_t flags, uint32_t seed)
+{
+    chry_blockpool_t bp;
+    void *addrs[64];
+    void *addr;
+    uint32_t n;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, block_size, mempool, sizeof(mempool), flags));
+
+    srand(seed);
+    live_cnt = 0;
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint32_t op = rand() % 8;
+
+        if ((op < 3) && (live_cnt < MAX_LIVE)) {
+            /*!< alloc one, never a live block, inside pool and aligned */
+            if (0 == chry_blockpool_alloc(&bp, &addr)) {
+                CHECK(((uintptr_t)addr - (uintptr_t)mempool) < sizeof(mempool));
+                CHECK(0 == (((uintptr_t)addr - (uintptr_t)mempool) % bp.block_size));
+                CHECK(!is_live(addr));
+                live[live_cnt++] = addr;
+            } else {
+                CHECK(chry_blockpool_check_nomem(&bp));
+            }
+        } else if ((op == 3) && live_cnt) {
+            addr = take_live(rand() % live_cnt);
+
+            if (flags & CHRY_BLOCKPOOL_FLAG_REMOTE) {
+                CHECK(0 == chry_blockpool_free_remote(&bp, addr));
+            } else {
+                CHECK(0 == chry_blockpool_free(&bp, addr));
+
+                /*!< mpsc mode detect already free only with bitmap */
+                if (!(flags & CHRY_BLOCKPOOL_FLAG_MPSC) || (flags & CHRY_BLOCKPOOL_FLAG_BITMAP)) {
+                    CHECK(-2 == chry_blockpool_free(&bp, addr));
+                }
+            }
+        } else if ((op == 4) && live_cnt) {
+            chry_blockpool_free_fast(&bp, take_live(rand() % live_cnt));
+        } else if (op == 5) {
+            /*!< burst may stop short, bulk all or nothing */
+            n = rand() % 64;
+            n = (n > MAX_LIVE - live_cnt) ? MAX_LIVE - live_cnt : n;
+
+            if (rand() & 1) {
+                n = chry_blockpool_alloc_burst(&bp, addrs, n);
+            } else if (chry_blockpool_alloc_bulk(&bp, addrs, n)) {
+                CHECK(n > chry_blockpool_get_free(&bp));
+                n = 0;
+            }
+
+            for (uint32_t i = 0; i < n; i++) {
+                CHECK(!is_live(addrs[i]));
+                live[live_cnt++] = addrs[i];
+            }
+        } else if (op == 6) {
+            n = live_cnt ? rand() % (live_cnt + 1) : 0;
+            n = n > 64 ? 64 : n;
+
+            for (uint32_t i = 0; i < n; i++) {
+                addrs[i] = take_live(rand() % live_cnt);
+            }
+
+            if (rand() & 1) {
+                CHECK(n == chry_blockpool_free_burst(&bp, addrs, n));
+            } else {
+                CHECK(0 == chry_blockpool_free_bulk(&bp, addrs, n));
+            }
+        } else if (op == 7) {
+            /*!< not a block start, or past the last block */
+            CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)mempool + 1));
+            CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)mempool + bp.block_cnt * bp.block_size));
+
+            if (live_cnt) {
+                CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)live[rand() % live_cnt] + 8));
+            }
+        }
+
+        /*!< remote freed block count as used until reclaimed */
+        if (!(flags & CHRY_BLOCKPOOL_FLAG_REMOTE)) {
+            CHECK(chry_blockpool_get_used(&bp) == live_cnt);
+        }
+
+        CHECK(chry_blockpool_get_used(&bp) + chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+    }
+
+    /*!< reset free every block, lazy mode hand out never used block again */
+    chry_blockpool_reset(&bp);
+    CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+    if (!(flags & CHRY_BLOCKPOOL_FLAG_MPSC) || (flags & CHRY_BLOCKPOOL_FLAG_BITMAP)) {
+        CHECK(-2 == chry_blockpool_free(&bp, mempool));
+    }
+
+    for (live_cnt = 0; (live_cnt < MAX_LIVE) && (0 == chry_blockpool_alloc(&bp, &addr)); live[live_cnt++] = addr) {
+        CHECK(!is_live(addr));
+    }
+
+    CHECK(live_cnt == chry_blockpool_get_size(&bp));
+
+    return 0;
+}
+
+/*!< rejected init leave a live pool untouched */
+static int init_reject(void)
+{
+    chry_blockpool_t bp;
+    chry_blockpool_t copy;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, 32, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_BITMAP));
+    CHECK(0 == chry_blockpool_alloc(&bp, &addr));
+    memcpy(&copy, &bp, sizeof(bp));
+
+    CHECK(-1 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, 64, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_LIFO));
+    CHECK(-1 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, 64, mempool, 32, 0));
+    /*!< ringbuffer entry or bitmap word would land off its align */
+    CHECK(-1 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_4, 32, (uint8_t *)mempool + 4, sizeof(mempool) - 4, 0));
+    CHECK(-1 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_4, 32, (uint8_t *)mempool + 1, sizeof(mempool) - 1, CHRY_BLOCKPOOL_FLAG_BITMAP));
+    CHECK(0 == memcmp(&copy, &bp, sizeof(bp)));
+
+    CHECK(0 == chry_blockpool_free(&bp, addr));
+    CHECK(-2 == chry_blockpool_free(&bp, addr));
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t block_sizes[] = { 32, 24 };
+    static const uint32_t modes[] = {
+        0,
+        CHRY_BLOCKPOOL_FLAG_MPSC,
+        CHRY_BLOCKPOOL_FLAG_LIFO,
+        CHRY_BLOCKPOOL_FLAG_REMOTE,
+        CHRY_BLOCKPOOL_FLAG_REMOTE | CHRY_BLOCKPOOL_FLAG_MPSC,
+    };
+    int fail = init_reject() ? 1 : 0;
+
+    /*!< every mode with every bitmap, index and lazy combination */
+    for (uint32_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (uint32_t extra = 0; extra < 8; extra++) {
+            uint32_t flags = modes[m] | ((extra & 1) ? CHRY_BLOCKPOOL_FLAG_BITMAP : 0) |
+                             ((extra & 2) ? CHRY_BLOCKPOOL_FLAG_INDEX : 0) | ((extra & 4) ? CHRY_BLOCKPOOL_FLAG_LAZY : 0);
+
+            for (uint32_t seed = 1; seed <= 4; seed++) {
+                /*!< power of 2 and odd multiple block size, index by shift and inverse */
+                uint32_t block_size = block_sizes[seed & 1];
+
+                if (model_run(block_size, flags, seed)) {
+                    printf("block %u flags 0x%02x seed %u failed\n", block_size, flags, seed);
+                    fail = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    printf("test_model %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "chry_blockpool_mpmc.h"
+#include "test_util.h"
+
+#define POOL_SIZE  8192
+#define BLOCK_SIZE 24
+#define THREAD_CNT 4
+#define HOLD_CNT   8
+#define ROUNDS     5000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_blockpool_mpmc_t mp;
+static _Atomic int error;
+
+static void *worker(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    void *hold[HOLD_CNT];
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        uint32_t n = 0;
+
+        /*!< tag every held block, another owner would overwrite it */
+        while ((n < HOLD_CNT) && (0 == chry_blockpool_mpmc_alloc(&mp, &hold[n]))) {
+            *(uintptr_t *)hold[n++] = id;
+        }
+
+        sched_yield();
+
+        for (uint32_t j = 0; j < n; j++) {
+            if (*(uintptr_t *)hold[j] != id) {
+                atomic_store(&error, 1);
+            }
+
+            if (j & 1) {
+                chry_blockpool_mpmc_free_fast(&mp, hold[j]);
+            } else if (chry_blockpool_mpmc_free(&mp, hold[j])) {
+                atomic_store(&error, 1);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int mpmc_run(void)
+{
+    pthread_t thread[THREAD_CNT];
+    void *addr;
+
+    CHECK(0 == chry_blockpool_mpmc_init(&mp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool)));
+
+    /*!< odd block size index by shift and inverse, non multiple rejected */
+    CHECK(0 == chry_blockpool_mpmc_alloc(&mp, &addr));
+    CHECK(-1 == chry_blockpool_mpmc_free(&mp, (uint8_t *)addr + 8));
+    CHECK(0 == chry_blockpool_mpmc_free(&mp, addr));
+
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        pthread_create(&thread[i], NULL, worker, (void *)i);
+    }
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(0 == atomic_load(&error));
+    CHECK(chry_blockpool_mpmc_get_free(&mp) == chry_blockpool_mpmc_get_size(&mp));
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = mpmc_run() ? 1 : 0;
+
+    printf("test_mpmc %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
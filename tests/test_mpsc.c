@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include "chry_blockpool.h"
+#include "test_util.h"
+
+#define POOL_SIZE  32768
+#define BLOCK_SIZE 32
+#define THREAD_CNT 4
+#define ROUNDS     8000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_blockpool_t bp;
+
+/*!< one handoff queue per free thread, alloc thread -> free thread */
+static test_queue_t queue[THREAD_CNT];
+static _Atomic int error;
+
+static void *free_thread(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    uint32_t seq;
+    void *block;
+
+    while (NULL != (block = test_queue_pop(&queue[id], &seq))) {
+        if (*(uintptr_t *)block != id) {
+            atomic_store(&error, 1);
+        }
+
+        /*!< mix every free path that reserve by CAS */
+        switch (seq % 3) {
+            case 0:
+                if (chry_blockpool_free(&bp, block)) {
+                    atomic_store(&error, 1);
+                }
+                break;
+            case 1:
+                chry_blockpool_free_fast(&bp, block);
+                break;
+            default:
+                if (chry_blockpool_free_bulk(&bp, &block, 1)) {
+                    atomic_store(&error, 1);
+                }
+                break;
+        }
+    }
+
+    return NULL;
+}
+
+static int mpsc_run(uint32_t flags)
+{
+    pthread_t thread[THREAD_CNT];
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), flags));
+
+    atomic_store(&error, 0);
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_init(&queue[i]);
+        pthread_create(&thread[i], NULL, free_thread, (void *)i);
+    }
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        uintptr_t id = i % THREAD_CNT;
+
+        while (chry_blockpool_alloc(&bp, &addr)) {
+            sched_yield();
+        }
+        *(uintptr_t *)addr = id;
+        test_queue_push(&queue[id], addr);
+    }
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_close(&queue[i]);
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(0 == atomic_load(&error));
+    CHECK(0 == chry_blockpool_get_used(&bp));
+    CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t flags[] = {
+        CHRY_BLOCKPOOL_FLAG_MPSC,
+        CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_BITMAP,
+        CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_INDEX | CHRY_BLOCKPOOL_FLAG_LAZY,
+        CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_INDEX,
+    };
+    int fail = 0;
+
+    for (uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (mpsc_run(flags[i])) {
+            printf("flags 0x%02x failed\n", flags[i]);
+            fail = 1;
+        }
+    }
+
+    printf("test_mpsc %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*!< build numa in first for _GNU_SOURCE, check static node list parser */
+#include "chry_blockpool_numa.c"
+#include <string.h>
+#include "test_util.h"
+
+#define BLOCK_SIZE 64
+#define NODE_SIZE  20000
+#define MAX_BLOCK  (CHRY_BLOCKPOOL_NUMA_MAX * NODE_SIZE / BLOCK_SIZE)
+
+static void *hold[MAX_BLOCK];
+
+static int parse_check(void)
+{
+    static const struct {
+        const char *list;
+        uint32_t cnt;
+        uint32_t ids[CHRY_BLOCKPOOL_NUMA_MAX];
+    } cases[] = {
+        { "0\n", 1, { 0 } },
+        { "0-1\n", 2, { 0, 1 } },
+        { "0,2\n", 2, { 0, 2 } },
+        { "0-1,4\n", 3, { 0, 1, 4 } },
+        { "1,3-4,7", 4, { 1, 3, 4, 7 } },
+        { "0-15", CHRY_BLOCKPOOL_NUMA_MAX, { 0, 1, 2, 3, 4, 5, 6, 7 } },
+        { "2,x", 1, { 2 } },
+        { "3-1", 0, { 0 } },
+        { "\n", 0, { 0 } },
+    };
+    uint32_t ids[CHRY_BLOCKPOOL_NUMA_MAX];
+
+    for (uint32_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        CHECK(cases[c].cnt == util_parse_list(cases[c].list, ids, CHRY_BLOCKPOOL_NUMA_MAX));
+        CHECK(0 == memcmp(ids, cases[c].ids, cases[c].cnt * sizeof(uint32_t)));
+    }
+
+    return 0;
+}
+
+/*!< sparse kernel node id map to pool index, thread pinned so node stay put */
+static int node_check(void)
+{
+    chry_blockpool_numa_t np;
+    unsigned int node = 0;
+    cpu_set_t old;
+    cpu_set_t set;
+
+    CHECK(0 == sched_getaffinity(0, sizeof(old), &old));
+    CPU_ZERO(&set);
+    CPU_SET(sched_getcpu(), &set);
+    CHECK(0 == sched_setaffinity(0, sizeof(set), &set));
+    CHECK(0 == syscall(SYS_getcpu, NULL, &node, NULL));
+
+    np.node_cnt = 2;
+    np.node_id[0] = node + 1;
+    np.node_id[1] = node;
+    CHECK(1 == chry_blockpool_numa_get_node(&np));
+    CHECK(1 == chry_blockpool_numa_get_node(&np));
+
+    /*!< node of thread not in set fall back to first pool */
+    np.node_id[1] = node + 2;
+    CHECK(0 == chry_blockpool_numa_get_node(&np));
+
+    CHECK(0 == sched_setaffinity(0, sizeof(old), &old));
+
+    return 0;
+}
+
+static int numa_run(void)
+{
+    chry_blockpool_numa_t np;
+    uint32_t size = 0;
+    uint32_t cnt = 0;
+
+    CHECK(0 == chry_blockpool_numa_init(&np, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, NODE_SIZE));
+    CHECK((np.node_cnt >= 1) && (np.node_cnt <= CHRY_BLOCKPOOL_NUMA_MAX));
+    CHECK(chry_blockpool_numa_get_node(&np) < np.node_cnt);
+    CHECK(chry_blockpool_numa_get_node(&np) < np.node_cnt);
+    CHECK(np.stride >= NODE_SIZE);
+    CHECK(0 == (np.stride & (np.stride - 1)));
+
+    for (uint32_t i = 1; i < np.node_cnt; i++) {
+        CHECK(np.node_id[i - 1] < np.node_id[i]);
+    }
+
+    for (uint32_t i = 0; i < np.node_cnt; i++) {
+        size += chry_blockpool_mpmc_get_size(&np.pools[i]);
+    }
+
+    /*!< local node first, then every other node before nomem */
+    while ((cnt < MAX_BLOCK) && (0 == chry_blockpool_numa_alloc(&np, &hold[cnt]))) {
+        CHECK((uintptr_t)hold[cnt] - (uintptr_t)np.base < np.stride * np.node_cnt);
+        memset(hold[cnt], 0x3c, BLOCK_SIZE);
+        cnt++;
+    }
+
+    CHECK(cnt == size);
+
+    /*!< outside the mapping, in the stride tail past node memory, or not a block start */
+    CHECK(-1 == chry_blockpool_numa_free(&np, (uint8_t *)np.base - BLOCK_SIZE));
+    CHECK(-1 == chry_blockpool_numa_free(&np, (uint8_t *)np.base + np.stride - BLOCK_SIZE));
+    CHECK(-1 == chry_blockpool_numa_free(&np, (uint8_t *)np.base + np.stride * np.node_cnt));
+    CHECK(-1 == chry_blockpool_numa_free(&np, (uint8_t *)hold[0] + 1));
+
+    while (cnt) {
+        CHECK(0 == chry_blockpool_numa_free(&np, hold[--cnt]));
+    }
+
+    for (uint32_t i = 0; i < np.node_cnt; i++) {
+        CHECK(chry_blockpool_mpmc_get_free(&np.pools[i]) == chry_blockpool_mpmc_get_size(&np.pools[i]));
+    }
+
+    chry_blockpool_numa_deinit(&np);
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = (parse_check() || node_check() || numa_run()) ? 1 : 0;
+
+    printf("test_numa %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "chry_blockpool_page.h"
+#include "test_util.h"
+
+#define POOL_SIZE  (1024 * 1024)
+#define BLOCK_SIZE 200
+#define MAX_LIVE   8192
+#define ROUNDS     100000
+
+static void *live[MAX_LIVE];
+static uint32_t live_cnt;
+
+static int page_run(chry_blockpool_page_t *pp)
+{
+    void *addr;
+
+    /*!< never used block is already free */
+    CHECK(0 == chry_blockpool_page_alloc(pp, &addr));
+    CHECK(-2 == chry_blockpool_page_free(pp, (uint8_t *)addr + pp->block_size));
+    CHECK(0 == chry_blockpool_page_free(pp, addr));
+    CHECK(-2 == chry_blockpool_page_free(pp, addr));
+
+    srand(1);
+
+    for (uint32_t round = 0; round < ROUNDS; round++) {
+        uint32_t op = rand() % 8;
+
+        if ((op < 4) && (live_cnt < MAX_LIVE)) {
+            if (0 == chry_blockpool_page_alloc(pp, &addr)) {
+                memset(addr, 0x5a, pp->block_size);
+                live[live_cnt++] = addr;
+            }
+        } else if ((op < 7) && live_cnt) {
+            uint32_t idx = rand() % live_cnt;
+
+            addr = live[idx];
+            live[idx] = live[--live_cnt];
+
+            /*!< second free of a block on its page freed list is caught */
+            CHECK(-1 == chry_blockpool_page_free(pp, (uint8_t *)addr + 8));
+            CHECK(0 == chry_blockpool_page_free(pp, addr));
+            CHECK(-2 == chry_blockpool_page_free(pp, addr));
+        } else if (op == 7) {
+            chry_blockpool_page_trim(pp);
+        }
+
+        CHECK(chry_blockpool_page_get_used(pp) == live_cnt);
+    }
+
+    while (live_cnt) {
+        CHECK(0 == chry_blockpool_page_free(pp, live[--live_cnt]));
+    }
+
+    CHECK(0 == chry_blockpool_page_get_used(pp));
+
+    return 0;
+}
+
+int main(void)
+{
+    chry_blockpool_page_t pp;
+    void *pool = mmap(NULL, POOL_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    int fail = 0;
+
+    if ((MAP_FAILED == pool) || chry_blockpool_page_init(&pp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, pool, POOL_SIZE, 2) || page_run(&pp)) {
+        fail = 1;
+    }
+
+    if (MAP_FAILED != pool) {
+        munmap(pool, POOL_SIZE);
+    }
+
+    printf("test_page %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
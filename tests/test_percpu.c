@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <unistd.h>
+#include "chry_blockpool_percpu.h"
+#include "test_util.h"
+
+#define POOL_SIZE  32768
+#define BLOCK_SIZE 32
+#define DEPTH      16
+#define CPU_MAX    64
+#define THREAD_CNT 4
+#define HOLD_CNT   24
+#define ROUNDS     2000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static uint8_t stackmem[CHRY_BLOCKPOOL_PERCPU_SIZE(CPU_MAX, DEPTH)] __attribute__((aligned(64)));
+static chry_blockpool_t bp;
+static chry_blockpool_percpu_t pc;
+static _Atomic int error;
+
+static void *worker(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    void *hold[HOLD_CNT];
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        uint32_t n = 0;
+
+        while ((n < HOLD_CNT) && (0 == chry_blockpool_percpu_alloc(&pc, &hold[n]))) {
+            *(uintptr_t *)hold[n++] = id;
+        }
+
+        while (n) {
+            if (*(uintptr_t *)hold[--n] != id) {
+                atomic_store(&error, 1);
+            }
+            chry_blockpool_percpu_free(&pc, hold[n]);
+        }
+
+        /*!< flush own and other cpu stack while other thread use them */
+        if (0 == (i % 64)) {
+            chry_blockpool_percpu_flush(&pc, (uint32_t)(id + i) % pc.cpu_cnt);
+        }
+    }
+
+    return NULL;
+}
+
+static uint32_t stack_cnt(void)
+{
+    uint32_t cnt = 0;
+
+    for (uint32_t i = 0; i < pc.cpu_cnt; i++) {
+        cnt += (uint32_t)((chry_blockpool_percpu_stack_t *)(pc.stacks + i * pc.stride))->top;
+    }
+
+    return cnt;
+}
+
+static int percpu_run(void)
+{
+    uint32_t cpu_cnt = (uint32_t)sysconf(_SC_NPROCESSORS_CONF);
+    pthread_t thread[THREAD_CNT];
+    uint32_t cached;
+    void *addr;
+
+    cpu_cnt = (cpu_cnt > CPU_MAX) ? CPU_MAX : cpu_cnt;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_BITMAP));
+    CHECK(0 == chry_blockpool_percpu_init(&pc, &bp, cpu_cnt, DEPTH, stackmem, sizeof(stackmem)));
+
+    /*!< empty stack refill a batch, cached block count as used in backing pool */
+    CHECK(0 == chry_blockpool_percpu_alloc(&pc, &addr));
+    chry_blockpool_percpu_free(&pc, addr);
+    CHECK(chry_blockpool_get_used(&bp) == pc.batch);
+    CHECK(stack_cnt() == pc.batch);
+    CHECK(chry_blockpool_percpu_drain(&pc) == pc.batch);
+    CHECK(0 == chry_blockpool_get_used(&bp));
+    CHECK(0 == stack_cnt());
+
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        pthread_create(&thread[i], NULL, worker, (void *)i);
+    }
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    /*!< every block either free in backing pool or on a cpu stack */
+    CHECK(0 == atomic_load(&error));
+    CHECK(chry_blockpool_get_used(&bp) == stack_cnt());
+
+    /*!< drain give every cached block back */
+    cached = stack_cnt();
+    CHECK(chry_blockpool_percpu_drain(&pc) == cached);
+    CHECK(0 == chry_blockpool_get_used(&bp));
+    CHECK(0 == stack_cnt());
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = percpu_run() ? 1 : 0;
+
+    printf("test_percpu %s rseq %d\n", fail ? "FAIL" : "PASS", pc.rseq);
+    return fail;
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_blockpool.h"
+#include "test_util.h"
+
+#define BLOCK_SIZE  32
+#define MAIN_SIZE   2048
+#define REGION_SIZE 8192
+#define MAX_BLOCK   ((MAIN_SIZE + 2 * CHRY_BLOCKPOOL_REGION_MAX * REGION_SIZE) / BLOCK_SIZE)
+
+static uint64_t mempool[MAIN_SIZE / sizeof(uint64_t)];
+/*!< region use half its slot, gap between regions */
+static uint64_t region[CHRY_BLOCKPOOL_REGION_MAX + 1][2 * REGION_SIZE / sizeof(uint64_t)];
+static void *hold[MAX_BLOCK];
+
+static int in_pool(chry_blockpool_t *bp, void *addr)
+{
+    uintptr_t address = (uintptr_t)addr - (uintptr_t)mempool;
+
+    if (address < (uintptr_t)bp->block_cnt * BLOCK_SIZE) {
+        return 0 == address % BLOCK_SIZE;
+    }
+
+    for (uint32_t r = 0; r < bp->region_cnt; r++) {
+        address = (uintptr_t)addr - (uintptr_t)(bp->regions[r].pool);
+        if (address < (uintptr_t)bp->regions[r].block_cnt * BLOCK_SIZE) {
+            return 0 == address % BLOCK_SIZE;
+        }
+    }
+
+    return 0;
+}
+
+/*!< alloc dry, every block inside one region, none twice, then free all checked */
+static int drain(chry_blockpool_t *bp, uint32_t flags)
+{
+    uint32_t cnt = 0;
+
+    while ((cnt < MAX_BLOCK) && (0 == chry_blockpool_alloc(bp, &hold[cnt]))) {
+        CHECK(in_pool(bp, hold[cnt]));
+        for (uint32_t i = 0; i < cnt; i++) {
+            CHECK(hold[i] != hold[cnt]);
+        }
+        cnt++;
+    }
+
+    CHECK(cnt == chry_blockpool_get_size(bp));
+    CHECK(0 == chry_blockpool_get_free(bp));
+
+    while (cnt) {
+        CHECK(0 == chry_blockpool_free(bp, hold[--cnt]));
+        if (!(flags & CHRY_BLOCKPOOL_FLAG_MPSC)) {
+            CHECK(-2 == chry_blockpool_free(bp, hold[cnt]));
+        }
+    }
+
+    CHECK(chry_blockpool_get_free(bp) == chry_blockpool_get_size(bp));
+
+    return 0;
+}
+
+static int region_run(uint32_t flags)
+{
+    chry_blockpool_t bp;
+    uint32_t size;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), flags));
+
+    /*!< move the read pointer off 0 before the ring migrate */
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(0 == chry_blockpool_alloc(&bp, &hold[i]));
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        CHECK(0 == chry_blockpool_free(&bp, hold[i]));
+    }
+
+    /*!< regions out of address order, the table stay sorted, last one full slot for a larger ring */
+    for (uint32_t r = CHRY_BLOCKPOOL_REGION_MAX; r > 0; r--) {
+        size = chry_blockpool_get_size(&bp);
+        CHECK(0 == chry_blockpool_add_region(&bp, region[r - 1], (r > 1) ? REGION_SIZE : 2 * REGION_SIZE));
+        CHECK(chry_blockpool_get_size(&bp) > size);
+        CHECK(2 == chry_blockpool_get_used(&bp));
+        CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp) - 2);
+    }
+
+    for (uint32_t r = 1; r < bp.region_cnt; r++) {
+        CHECK((uintptr_t)bp.regions[r - 1].pool < (uintptr_t)bp.regions[r].pool);
+    }
+
+    /*!< table full, overlap with the first region or an extra region */
+    CHECK(-1 == chry_blockpool_add_region(&bp, region[CHRY_BLOCKPOOL_REGION_MAX], REGION_SIZE));
+    bp.region_cnt--;
+    CHECK(-1 == chry_blockpool_add_region(&bp, (uint8_t *)mempool + BLOCK_SIZE, REGION_SIZE));
+    CHECK(-1 == chry_blockpool_add_region(&bp, (uint8_t *)region[0] + REGION_SIZE / 2, REGION_SIZE));
+    bp.region_cnt++;
+
+    CHECK(0 == chry_blockpool_free(&bp, hold[3]));
+    CHECK(0 == chry_blockpool_free(&bp, hold[4]));
+    CHECK(0 == drain(&bp, flags));
+
+    /*!< not a block start, outside every region, gap between regions */
+    CHECK(0 == chry_blockpool_alloc(&bp, &addr));
+    CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)region[1] + 1));
+    CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)region[CHRY_BLOCKPOOL_REGION_MAX]));
+    CHECK(-1 == chry_blockpool_free(&bp, (uint8_t *)region[1] + REGION_SIZE));
+    CHECK(0 == chry_blockpool_free(&bp, addr));
+
+    /*!< reset refill every region */
+    chry_blockpool_reset(&bp);
+    CHECK(0 == drain(&bp, flags));
+
+    return 0;
+}
+
+/*!< region off pointer align, carved ringbuffer still pointer aligned */
+static int region_unaligned(void)
+{
+    chry_blockpool_t bp;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_4, BLOCK_SIZE, mempool, sizeof(mempool), 0));
+    CHECK(0 == chry_blockpool_add_region(&bp, (uint8_t *)region[0] + 4, 2 * REGION_SIZE - 4));
+    CHECK(0 == ((uintptr_t)(bp.rb_pool) & (sizeof(void *) - 1)));
+    CHECK(0 == drain(&bp, 0));
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t flags[] = {
+        0,
+        CHRY_BLOCKPOOL_FLAG_LIFO,
+        CHRY_BLOCKPOOL_FLAG_MPSC,
+        CHRY_BLOCKPOOL_FLAG_LAZY,
+    };
+    chry_blockpool_t bp;
+    int fail = 0;
+
+    for (uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (region_run(flags[i])) {
+            printf("flags 0x%02x failed\n", flags[i]);
+            fail = 1;
+        }
+    }
+
+    if (region_unaligned()) {
+        printf("unaligned region failed\n");
+        fail = 1;
+    }
+
+    /*!< region block has no bitmap bit nor index */
+    if (chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_BITMAP) ||
+        (-1 != chry_blockpool_add_region(&bp, region[0], REGION_SIZE)) ||
+        chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_INDEX) ||
+        (-1 != chry_blockpool_add_region(&bp, region[0], REGION_SIZE))) {
+        printf("bitmap or index region accepted\n");
+        fail = 1;
+    }
+
+    printf("test_region %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
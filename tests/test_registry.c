@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "test_util.h"
+
+/*!< build registry in, failed register must leave every table and count as it was */
+#include "chry_blockpool_registry.c"
+
+#define BLOCK_SIZE 64
+#define LEAF_SPAN  ((uintptr_t)REGISTRY_FANOUT << REGISTRY_SPAN_SHIFT)
+#define BIG_SIZE   (40UL << 20)
+
+static uint8_t mempool[16384] __attribute__((aligned(4096)));
+static uint8_t region[8192] __attribute__((aligned(4096)));
+
+typedef struct {
+    void *node[CHRY_BLOCKPOOL_REGISTRY_NODE_MAX][REGISTRY_FANOUT];
+    void *leaf[CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX][REGISTRY_FANOUT];
+    void *sub[CHRY_BLOCKPOOL_REGISTRY_SUB_MAX][2 * REGISTRY_SUB];
+    uint32_t node_cnt;
+    uint32_t leaf_cnt;
+    uint32_t sub_cnt;
+} registry_state_t;
+
+static registry_state_t saved;
+static registry_state_t state;
+
+static void snapshot(registry_state_t *st)
+{
+    memset(st, 0, sizeof(*st));
+    memcpy(st->node, (void *)registry_node, sizeof(st->node));
+    memcpy(st->leaf, (void *)registry_leaf, sizeof(st->leaf));
+    memcpy(st->sub, (void *)registry_sub, sizeof(st->sub));
+    st->node_cnt = registry_node_cnt;
+    st->leaf_cnt = registry_leaf_cnt;
+    st->sub_cnt = registry_sub_cnt;
+}
+
+/*!< one pool over several leaves, inside span answer from leaf entry, edges from sub leaf */
+static int big_run(void)
+{
+    chry_blockpool_t big;
+    uint8_t *buf = aligned_alloc(4096, BIG_SIZE + 2 * LEAF_SPAN);
+    uint8_t *pool;
+    uint8_t *end;
+    uint32_t leaf_cnt = registry_leaf_cnt;
+    uint32_t sub_cnt = registry_sub_cnt;
+    uint32_t cnt = 0;
+    void *addr;
+
+    CHECK(NULL != buf);
+
+    /*!< start off span align, past a leaf boundary, end in another leaf */
+    pool = (uint8_t *)(((uintptr_t)buf + 4 * 4096 + LEAF_SPAN - 1) & ~(LEAF_SPAN - 1)) - 3 * 4096 - 128;
+    CHECK(0 == chry_blockpool_init(&big, CHRY_BLOCKPOOL_ALIGN_8, 4096, pool, BIG_SIZE));
+    end = pool + (uintptr_t)big.block_cnt * big.block_size;
+    CHECK((uintptr_t)(end - pool) > LEAF_SPAN);
+
+    CHECK(0 == chry_blockpool_register(&big));
+    CHECK(registry_leaf_cnt - leaf_cnt >= 2);
+    CHECK(registry_sub_cnt - sub_cnt <= 2);
+
+    CHECK(NULL == chry_blockpool_lookup(pool - 50));
+    CHECK(&big == chry_blockpool_lookup(pool));
+    CHECK(NULL == chry_blockpool_lookup(end + 8192));
+
+    while (0 == chry_blockpool_alloc(&big, &addr)) {
+        CHECK(&big == chry_blockpool_lookup(addr));
+        CHECK(&big == chry_blockpool_lookup((uint8_t *)addr + 4095));
+        cnt++;
+    }
+
+    CHECK(cnt == big.block_cnt);
+    CHECK(0 == chry_free(pool));
+    CHECK(-2 == chry_free(pool));
+    CHECK(0 == chry_free(pool + LEAF_SPAN / 4096 * 4096));
+
+    chry_blockpool_unregister(&big);
+    CHECK(NULL == chry_blockpool_lookup(pool));
+    CHECK(NULL == chry_blockpool_lookup(pool + LEAF_SPAN / 2));
+
+    free(buf);
+
+    return 0;
+}
+
+/*!< lazy pool never touch block memory, so address only pools stand in for huge ones */
+static int fail_run(chry_blockpool_t *a)
+{
+    chry_blockpool_t z;
+    uintptr_t start;
+    uint32_t size;
+
+    snapshot(&saved);
+
+    /*!< reach from fresh leaves below into region a start in, conflict after new path */
+    size = 32UL << 20;
+    CHECK(0 == chry_blockpool_init_ex(&z, CHRY_BLOCKPOOL_ALIGN_8, 4096, (void *)((uintptr_t)mempool - size), size, CHRY_BLOCKPOOL_FLAG_LAZY));
+    start = (uintptr_t)mempool + 2048 - (uintptr_t)z.block_cnt * z.block_size;
+    CHECK(0 == chry_blockpool_init_ex(&z, CHRY_BLOCKPOOL_ALIGN_8, 4096, (void *)start, size, CHRY_BLOCKPOOL_FLAG_LAZY));
+    CHECK(a == chry_blockpool_lookup(mempool));
+    CHECK(-1 == chry_blockpool_register(&z));
+
+    snapshot(&state);
+    CHECK(0 == memcmp(&saved, &state, sizeof(state)));
+
+    /*!< far away, one leaf more than left, run out half way */
+    size = (uint32_t)((CHRY_BLOCKPOOL_REGISTRY_LEAF_MAX - registry_leaf_cnt + 2) * LEAF_SPAN);
+    start = (((uintptr_t)mempool + ((uintptr_t)0x1 << 40)) & ~(LEAF_SPAN - 1)) + 4096;
+    CHECK(0 == chry_blockpool_init_ex(&z, CHRY_BLOCKPOOL_ALIGN_8, 4096, (void *)start, size, CHRY_BLOCKPOOL_FLAG_LAZY));
+    CHECK(-2 == chry_blockpool_register(&z));
+    CHECK(NULL == chry_blockpool_lookup((void *)(start + 4096)));
+
+    snapshot(&state);
+    CHECK(0 == memcmp(&saved, &state, sizeof(state)));
+
+    return 0;
+}
+
+static int registry_run(void)
+{
+    chry_blockpool_t a;
+    chry_blockpool_t b;
+    chry_blockpool_t c;
+    void *addr;
+
+    /*!< a and b adjacent, b start inside the region a cover, c start in the same region as b */
+    CHECK(0 == chry_blockpool_init(&a, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, 5000));
+    CHECK(0 == chry_blockpool_init(&b, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool + 5000, 2000));
+    CHECK(0 == chry_blockpool_init(&c, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool + 7000, 2000));
+    CHECK(0 == chry_blockpool_register(&a));
+    CHECK(0 == chry_blockpool_register(&b));
+    CHECK(-1 == chry_blockpool_register(&c));
+    CHECK(0 == fail_run(&a));
+    CHECK(NULL == chry_blockpool_lookup(mempool + 12000));
+
+    while (0 == chry_blockpool_alloc(&a, &addr)) {
+        CHECK(&a == chry_blockpool_lookup(addr));
+    }
+    CHECK(0 == chry_blockpool_alloc(&b, &addr));
+    CHECK(&b == chry_blockpool_lookup(addr));
+    CHECK(0 == chry_free(addr));
+    CHECK(-2 == chry_free(addr));
+
+#ifdef CHRY_BLOCKPOOL_REGION_MAX
+    /*!< extra region blocks reach chry_free once registered again */
+    CHECK(0 == chry_blockpool_add_region(&a, region, sizeof(region)));
+    CHECK(NULL == chry_blockpool_lookup(region + BLOCK_SIZE));
+    CHECK(0 == chry_blockpool_register(&a));
+
+    while (0 == chry_blockpool_alloc(&a, &addr)) {
+        CHECK(&a == chry_blockpool_lookup(addr));
+        if ((uint8_t *)addr >= region) {
+            CHECK(0 == chry_free(addr));
+            break;
+        }
+    }
+
+    chry_blockpool_unregister(&a);
+    CHECK(NULL == chry_blockpool_lookup(region + BLOCK_SIZE));
+#else
+    (void)region;
+    chry_blockpool_unregister(&a);
+#endif
+
+    CHECK(NULL == chry_blockpool_lookup(mempool));
+    CHECK(-1 == chry_free(mempool));
+    CHECK(&b == chry_blockpool_lookup(mempool + 5000));
+
+    /*!< b gone, c may take the region now */
+    chry_blockpool_unregister(&b);
+    CHECK(0 == chry_blockpool_register(&c));
+    CHECK(&c == chry_blockpool_lookup(mempool + 7000));
+    chry_blockpool_unregister(&c);
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = (registry_run() || big_run()) ? 1 : 0;
+
+    printf("test_registry %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include "chry_blockpool.h"
+#include "test_util.h"
+
+#define POOL_SIZE  8192
+#define BLOCK_SIZE 32
+#define THREAD_CNT 3
+#define HOLD_CNT   8
+#define ROUNDS     20000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_blockpool_t bp;
+
+/*!< one handoff queue per remote thread, owner thread -> remote thread */
+static test_queue_t queue[THREAD_CNT];
+static _Atomic int error;
+static void *drain[POOL_SIZE / BLOCK_SIZE];
+
+static void *remote_thread(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    uint32_t seq;
+    void *block;
+
+    while (NULL != (block = test_queue_pop(&queue[id], &seq))) {
+        /*!< non owner local free only with mpsc */
+        if ((bp.flags & CHRY_BLOCKPOOL_FLAG_MPSC) && (seq & 1)) {
+            if (chry_blockpool_free(&bp, block)) {
+                atomic_store(&error, 1);
+            }
+        } else if (chry_blockpool_free_remote(&bp, block)) {
+            atomic_store(&error, 1);
+        }
+    }
+
+    return NULL;
+}
+
+static int remote_run(uint32_t flags)
+{
+    pthread_t thread[THREAD_CNT];
+    void *hold[HOLD_CNT];
+    uint32_t hold_cnt = 0;
+    uint32_t drain_cnt = 0;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), flags));
+
+    atomic_store(&error, 0);
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_init(&queue[i]);
+        pthread_create(&thread[i], NULL, remote_thread, (void *)i);
+    }
+
+    /*!< owner alloc, keep a few for local free, hand the rest to remote thread */
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        while (chry_blockpool_alloc(&bp, &addr)) {
+            sched_yield();
+        }
+
+        if (i & 1) {
+            if (HOLD_CNT == hold_cnt) {
+                while (hold_cnt) {
+                    CHECK(0 == chry_blockpool_free(&bp, hold[--hold_cnt]));
+                }
+            }
+            hold[hold_cnt++] = addr;
+            continue;
+        }
+
+        test_queue_push(&queue[(i / 2) % THREAD_CNT], addr);
+    }
+
+    while (hold_cnt) {
+        chry_blockpool_free_fast(&bp, hold[--hold_cnt]);
+    }
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_close(&queue[i]);
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(0 == atomic_load(&error));
+
+    /*!< remote freed block count as used until owner reclaim, alloc dry to reclaim all */
+    while ((drain_cnt < POOL_SIZE / BLOCK_SIZE) && (0 == chry_blockpool_alloc(&bp, &drain[drain_cnt]))) {
+        drain_cnt++;
+    }
+
+    CHECK(drain_cnt == chry_blockpool_get_size(&bp));
+
+    while (drain_cnt) {
+        chry_blockpool_free_fast(&bp, drain[--drain_cnt]);
+    }
+
+    CHECK(0 == chry_blockpool_get_used(&bp));
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t flags[] = {
+        CHRY_BLOCKPOOL_FLAG_REMOTE,
+        CHRY_BLOCKPOOL_FLAG_REMOTE | CHRY_BLOCKPOOL_FLAG_BITMAP,
+        CHRY_BLOCKPOOL_FLAG_REMOTE | CHRY_BLOCKPOOL_FLAG_MPSC,
+        CHRY_BLOCKPOOL_FLAG_REMOTE | CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_INDEX,
+    };
+    int fail = 0;
+
+    for (uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (remote_run(flags[i])) {
+            printf("flags 0x%02x failed\n", flags[i]);
+            fail = 1;
+        }
+    }
+
+    printf("test_remote %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include "chry_blockpool_shard.h"
+#include "test_util.h"
+
+#define POOL_SIZE  16384
+#define BLOCK_SIZE 64
+#define SHARD_CNT  4
+#define HOLD_MAX   96
+#define ROUNDS     3000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_blockpool_shard_t shards[SHARD_CNT];
+static chry_blockpool_shard_set_t set;
+static _Atomic int error;
+
+static void *worker(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    void *hold[HOLD_MAX];
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        /*!< uneven hold count, busy shard run dry and steal from others */
+        uint32_t want = (id & 1) ? HOLD_MAX : 4;
+        uint32_t n = 0;
+
+        while ((n < want) && (0 == chry_blockpool_shard_alloc(&set, id, &hold[n]))) {
+            *(uintptr_t *)hold[n] = id;
+            n++;
+        }
+
+        sched_yield();
+
+        while (n) {
+            if (*(uintptr_t *)hold[--n] != id) {
+                atomic_store(&error, 1);
+            }
+            if (chry_blockpool_shard_free(&set, hold[n])) {
+                atomic_store(&error, 1);
+            }
+        }
+    }
+
+    chry_blockpool_shard_flush(&set, id);
+
+    return NULL;
+}
+
+static int shard_run(void)
+{
+    pthread_t thread[SHARD_CNT];
+
+    CHECK(0 == chry_blockpool_shard_init(&set, shards, SHARD_CNT, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool)));
+
+    for (uintptr_t i = 0; i < SHARD_CNT; i++) {
+        pthread_create(&thread[i], NULL, worker, (void *)i);
+    }
+
+    /*!< free count read from other thread while owners alloc and free */
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        CHECK(chry_blockpool_shard_get_free(&set) <= chry_blockpool_shard_get_size(&set));
+        sched_yield();
+    }
+
+    for (uint32_t i = 0; i < SHARD_CNT; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(0 == atomic_load(&error));
+    CHECK(chry_blockpool_shard_get_free(&set) == chry_blockpool_shard_get_size(&set));
+
+    /*!< not a block of any shard */
+    CHECK(-1 == chry_blockpool_shard_free(&set, (uint8_t *)mempool + 1));
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = shard_run() ? 1 : 0;
+
+    printf("test_shard %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
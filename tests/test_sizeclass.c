@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "chry_sizeclass_pool.h"
+#include "test_util.h"
+
+#define POOL_SIZE 262144
+#define MIN_SIZE  32
+#define MAX_SIZE  4096
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_sizeclass_pool_t sp;
+
+static int class_select(void)
+{
+    uint32_t c;
+
+    /*!< every request size map to the smallest class that fit */
+    for (uint32_t size = 1; size <= sp.max_size; size++) {
+        c = chry_sizeclass_pool_get_class(&sp, size);
+
+        CHECK(c < sp.class_cnt);
+        CHECK(sp.class_size[c] >= size);
+        CHECK((0 == c) || (sp.class_size[c - 1] < size));
+    }
+
+    /*!< class size grow, waste below 25% past the first class */
+    for (c = 1; c < sp.class_cnt; c++) {
+        CHECK(sp.class_size[c] > sp.class_size[c - 1]);
+        CHECK((sp.class_size[c] - sp.class_size[c - 1]) * 4 <= sp.class_size[c]);
+    }
+
+    CHECK(MIN_SIZE == sp.class_size[0]);
+    CHECK(MAX_SIZE == sp.max_size);
+    CHECK(sp.class_cnt == chry_sizeclass_pool_get_class(&sp, MAX_SIZE + 1));
+
+    return 0;
+}
+
+static int class_alloc(void)
+{
+    static const uint32_t sizes[] = { 1, 32, 33, 100, 1000, 4095, 4096 };
+    void *addr;
+    void *other;
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t c = chry_sizeclass_pool_get_class(&sp, sizes[i]);
+
+        CHECK(0 == chry_sizeclass_pool_alloc(&sp, sizes[i], &addr));
+        CHECK(sp.class_size[c] == chry_sizeclass_pool_get_block_size(&sp, addr));
+        CHECK(1 == chry_blockpool_get_used(&sp.classes[c]));
+
+        CHECK(0 == chry_sizeclass_pool_free(&sp, addr));
+        CHECK(-2 == chry_sizeclass_pool_free(&sp, addr));
+        CHECK(0 == chry_blockpool_get_used(&sp.classes[c]));
+    }
+
+    /*!< too large, lookup table and pointer outside every class */
+    CHECK(-1 == chry_sizeclass_pool_alloc(&sp, MAX_SIZE + 1, &addr));
+    CHECK(-1 == chry_sizeclass_pool_free(&sp, sp.lookup));
+    CHECK(-1 == chry_sizeclass_pool_free(&sp, (uint8_t *)mempool + sizeof(mempool)));
+    CHECK(0 == chry_sizeclass_pool_get_block_size(&sp, sp.lookup));
+
+    /*!< a class run dry does not borrow from a larger class */
+    CHECK(0 == chry_sizeclass_pool_alloc(&sp, MAX_SIZE, &other));
+    while (0 == chry_sizeclass_pool_alloc(&sp, MAX_SIZE, &addr)) {
+    }
+    CHECK(chry_blockpool_get_free(&sp.classes[sp.class_cnt - 1]) == 0);
+    CHECK(0 == chry_sizeclass_pool_alloc(&sp, MIN_SIZE, &addr));
+    CHECK(MIN_SIZE == chry_sizeclass_pool_get_block_size(&sp, addr));
+
+    chry_sizeclass_pool_reset(&sp);
+    for (uint32_t c = 0; c < sp.class_cnt; c++) {
+        CHECK(chry_blockpool_get_free(&sp.classes[c]) == chry_blockpool_get_size(&sp.classes[c]));
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    if (-1 != chry_sizeclass_pool_init(&sp, CHRY_BLOCKPOOL_ALIGN_8, MAX_SIZE, MIN_SIZE, mempool, sizeof(mempool), 0) ||
+        chry_sizeclass_pool_init(&sp, CHRY_BLOCKPOOL_ALIGN_8, MIN_SIZE, MAX_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_LAZY) ||
+        class_select() || class_alloc()) {
+        fail = 1;
+    }
+
+    printf("test_sizeclass %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include "chry_blockpool.h"
+
+#define TEST_QUEUE_SIZE 256
+#include "test_util.h"
+
+#define POOL_SIZE  16384
+#define BLOCK_SIZE 16
+#define ROUNDS     50000
+
+static uint64_t mempool[POOL_SIZE / sizeof(uint64_t)];
+static chry_blockpool_t bp;
+
+/*!< handoff queue alloc thread -> free thread */
+static test_queue_t queue;
+static _Atomic int error;
+
+static void *free_thread(void *arg)
+{
+    uint32_t seq;
+    uint32_t *block;
+
+    (void)arg;
+
+    while (NULL != (block = test_queue_pop(&queue, &seq))) {
+        if (*block != seq) {
+            atomic_store(&error, 1);
+        }
+
+        if (seq & 1) {
+            chry_blockpool_free_fast(&bp, block);
+        } else if (chry_blockpool_free(&bp, block)) {
+            atomic_store(&error, 1);
+        }
+    }
+
+    return NULL;
+}
+
+static int spsc_run(uint32_t flags)
+{
+    pthread_t thread;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), flags));
+
+    atomic_store(&error, 0);
+    test_queue_init(&queue);
+    pthread_create(&thread, NULL, free_thread, NULL);
+
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        while (chry_blockpool_alloc(&bp, &addr)) {
+            sched_yield();
+        }
+        *(uint32_t *)addr = i;
+        test_queue_push(&queue, addr);
+    }
+
+    test_queue_close(&queue);
+    pthread_join(thread, NULL);
+
+    CHECK(0 == atomic_load(&error));
+    CHECK(0 == chry_blockpool_get_used(&bp));
+    CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+
+    return 0;
+}
+
+int main(void)
+{
+    static const uint32_t flags[] = {
+        0,
+        CHRY_BLOCKPOOL_FLAG_BITMAP,
+        CHRY_BLOCKPOOL_FLAG_INDEX | CHRY_BLOCKPOOL_FLAG_LAZY,
+        CHRY_BLOCKPOOL_FLAG_BITMAP | CHRY_BLOCKPOOL_FLAG_INDEX,
+    };
+    int fail = 0;
+
+    for (uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+        if (spsc_run(flags[i])) {
+            printf("flags 0x%02x failed\n", flags[i]);
+            fail = 1;
+        }
+    }
+
+    printf("test_spsc %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: %s\n", __func__, __LINE__, #cond);               \
+            return -1;                                                      \
+        }                                                                   \
+    } while (0)
+
+#ifndef TEST_QUEUE_SIZE
+#define TEST_QUEUE_SIZE 64
+#endif
+
+/*!< one producer one consumer block handoff between test threads */
+typedef struct {
+    void *slot[TEST_QUEUE_SIZE];
+    _Atomic uint32_t in;
+    _Atomic uint32_t out;
+    _Atomic int done;
+} test_queue_t;
+
+static inline void test_queue_init(test_queue_t *q)
+{
+    atomic_store(&(q->in), 0);
+    atomic_store(&(q->out), 0);
+    atomic_store(&(q->done), 0);
+}
+
+/*!< producer, wait for room */
+static inline void test_queue_push(test_queue_t *q, void *addr)
+{
+    uint32_t in = atomic_load_explicit(&(q->in), memory_order_relaxed);
+
+    while (in - atomic_load_explicit(&(q->out), memory_order_acquire) >= TEST_QUEUE_SIZE) {
+        sched_yield();
+    }
+
+    q->slot[in % TEST_QUEUE_SIZE] = addr;
+    atomic_store_explicit(&(q->in), in + 1, memory_order_release);
+}
+
+/*!< producer, no more push */
+static inline void test_queue_close(test_queue_t *q)
+{
+    atomic_store(&(q->done), 1);
+}
+
+/*!< consumer, wait for a block, NULL once closed and empty, seq count from 0 in push order */
+static inline void *test_queue_pop(test_queue_t *q, uint32_t *seq)
+{
+    uint32_t out = atomic_load_explicit(&(q->out), memory_order_relaxed);
+    void *addr;
+
+    while (out == atomic_load_explicit(&(q->in), memory_order_acquire)) {
+        if (atomic_load(&(q->done)) && (out == atomic_load(&(q->in)))) {
+            return NULL;
+        }
+        sched_yield();
+    }
+
+    addr = q->slot[out % TEST_QUEUE_SIZE];
+    atomic_store_explicit(&(q->out), out + 1, memory_order_release);
+    *seq = out;
+
+    return addr;
+}
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2022, Egahp
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "chry_blockpool_wait.h"
+#include "test_util.h"
+
+#define BLOCK_SIZE 32
+#define THREAD_CNT 2
+#define ROUNDS     20000
+#define LOW_WATER  16
+#define MAX_BLOCK  (sizeof(mempool) / BLOCK_SIZE)
+
+static uint64_t mempool[512];
+static chry_blockpool_t bp;
+
+/*!< one handoff queue per free thread, alloc thread -> free thread */
+static test_queue_t queue[THREAD_CNT];
+static void *hold[MAX_BLOCK];
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *free_thread(void *arg)
+{
+    uintptr_t id = (uintptr_t)arg;
+    uint32_t seq;
+    void *block;
+
+    while (NULL != (block = test_queue_pop(&queue[id], &seq))) {
+        chry_blockpool_free_fast(&bp, block);
+    }
+
+    return NULL;
+}
+
+static int wait_timeout(void)
+{
+    void *addr;
+    uint64_t start;
+
+    /*!< lifo mode alloc and free share one lock, empty pool never sleep */
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_LIFO));
+    while (0 == chry_blockpool_alloc(&bp, &addr)) {
+    }
+    CHECK(-3 == chry_blockpool_alloc_wait(&bp, &addr, 0));
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_MPSC));
+    while (0 == chry_blockpool_alloc(&bp, &addr)) {
+    }
+
+    start = now_ns();
+    CHECK(-1 == chry_blockpool_alloc_wait(&bp, &addr, 5 * 1000 * 1000));
+    CHECK(now_ns() - start >= 5 * 1000 * 1000);
+
+    return 0;
+}
+
+static int wait_wakeup(uint32_t flags)
+{
+    pthread_t thread[THREAD_CNT];
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), flags));
+
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_init(&queue[i]);
+        pthread_create(&thread[i], NULL, free_thread, (void *)i);
+    }
+
+    /*!< queue deeper than pool, alloc thread sleep until a free thread give a block back */
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        CHECK(0 == chry_blockpool_alloc_wait(&bp, &addr, CHRY_BLOCKPOOL_WAIT_FOREVER));
+        test_queue_push(&queue[i % THREAD_CNT], addr);
+    }
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_close(&queue[i]);
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(chry_blockpool_get_free(&bp) == chry_blockpool_get_size(&bp));
+
+    return 0;
+}
+
+static int event_ready(void)
+{
+    pthread_t thread[THREAD_CNT];
+    struct pollfd pfd;
+    uint64_t value;
+    uint32_t cnt = 0;
+    void *addr;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_MPSC));
+    CHECK(-3 == chry_blockpool_event_arm(&bp));
+
+    pfd.fd = chry_blockpool_event_open(&bp, LOW_WATER);
+    pfd.events = POLLIN;
+    CHECK(pfd.fd >= 0);
+
+    /*!< already above low water, fire at arm */
+    CHECK(0 == chry_blockpool_event_arm(&bp));
+    CHECK(1 == poll(&pfd, 1, 0));
+    CHECK(sizeof(value) == read(pfd.fd, &value, sizeof(value)));
+
+    /*!< drain pool into queue, free thread start after arm */
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_init(&queue[i]);
+    }
+
+    while ((cnt < THREAD_CNT * TEST_QUEUE_SIZE) && (0 == chry_blockpool_alloc(&bp, &addr))) {
+        test_queue_push(&queue[cnt % THREAD_CNT], addr);
+        cnt++;
+    }
+
+    CHECK(0 == chry_blockpool_event_arm(&bp));
+    CHECK(0 == poll(&pfd, 1, 0));
+
+    for (uintptr_t i = 0; i < THREAD_CNT; i++) {
+        test_queue_close(&queue[i]);
+        pthread_create(&thread[i], NULL, free_thread, (void *)i);
+    }
+
+    /*!< concurrent free coalesce into one event */
+    CHECK(1 == poll(&pfd, 1, 5000));
+
+    for (uint32_t i = 0; i < THREAD_CNT; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    CHECK(sizeof(value) == read(pfd.fd, &value, sizeof(value)));
+    CHECK(1 == value);
+    CHECK(0 == poll(&pfd, 1, 0));
+
+    chry_blockpool_event_close(&bp);
+
+    return 0;
+}
+
+/*!< block freed by remote push sit on remote list, still count toward low water */
+static int event_remote(void)
+{
+    struct pollfd pfd;
+    uint64_t value;
+    uint32_t cnt = 0;
+
+    CHECK(0 == chry_blockpool_init_ex(&bp, CHRY_BLOCKPOOL_ALIGN_8, BLOCK_SIZE, mempool, sizeof(mempool), CHRY_BLOCKPOOL_FLAG_REMOTE));
+
+    pfd.fd = chry_blockpool_event_open(&bp, LOW_WATER);
+    pfd.events = POLLIN;
+    CHECK(pfd.fd >= 0);
+
+    while ((cnt < MAX_BLOCK) && (0 == chry_blockpool_alloc(&bp, &hold[cnt]))) {
+        cnt++;
+    }
+
+    CHECK(cnt == chry_blockpool_get_size(&bp));
+    CHECK(cnt > LOW_WATER);
+    CHECK(0 == chry_blockpool_event_arm(&bp));
+    CHECK(0 == poll(&pfd, 1, 0));
+
+    for (uint32_t i = 0; i < LOW_WATER - 1; i++) {
+        CHECK(0 == chry_blockpool_free_remote(&bp, hold[--cnt]));
+    }
+
+    CHECK(0 == poll(&pfd, 1, 0));
+    CHECK(0 == chry_blockpool_free_remote(&bp, hold[--cnt]));
+    CHECK(1 == poll(&pfd, 1, 0));
+    CHECK(sizeof(value) == read(pfd.fd, &value, sizeof(value)));
+
+    /*!< alloc reclaim the list, count move over to free ringbuffer */
+    CHECK(0 == chry_blockpool_alloc(&bp, &hold[cnt++]));
+    CHECK(0 == bp.remote_cnt);
+    CHECK(LOW_WATER - 1 == chry_blockpool_get_free(&bp));
+    CHECK(0 == chry_blockpool_event_arm(&bp));
+    CHECK(0 == poll(&pfd, 1, 0));
+
+    chry_blockpool_event_close(&bp);
+
+    return 0;
+}
+
+int main(void)
+{
+    int fail = 0;
+
+    if (wait_timeout()) {
+        fail = 1;
+    }
+
+    if (wait_wakeup(CHRY_BLOCKPOOL_FLAG_MPSC) || wait_wakeup(CHRY_BLOCKPOOL_FLAG_MPSC | CHRY_BLOCKPOOL_FLAG_INDEX)) {
+        fail = 1;
+    }
+
+    if (event_ready() || event_remote()) {
+        fail = 1;
+    }
+
+    printf("test_wait %s\n", fail ? "FAIL" : "PASS");
+    return fail;
+}